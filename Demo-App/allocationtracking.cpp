@@ -0,0 +1,127 @@
+/* =============================================================================
+Allocation tracking
+
+ - replaces the global allocation functions
+ - attributes each allocation to the subsystem in charge of the allocating thread
+ - feeds the heap usage per subsystem into the metrics report
+
+This translation unit is linked only into builds with allocation tracking enabled.
+==============================================================================*/
+
+import std;
+
+import metrics;
+
+namespace {
+
+// each block carries a header in front that tells its size and the subsystem that
+// allocated it, such that its release is attributed to the same subsystem. blocks with
+// an extended alignment are placed at an offset into their memory, the header also
+// tells where the memory begins.
+
+struct alignas(std::max_align_t) BlockHeader {
+	std::size_t Size_;
+	void * Memory_;
+	metrics::Subsystem Owner_;
+};
+
+void * allocate(std::size_t Size, std::size_t Alignment = alignof(BlockHeader)) noexcept {
+	// 'malloc' returns memory that is suitably aligned for the header already
+	Alignment          = std::max(Alignment, alignof(BlockHeader));
+	const auto Padding = Alignment - alignof(BlockHeader);
+	if (Size > std::numeric_limits<std::size_t>::max() - sizeof(BlockHeader) - Padding)
+		return nullptr;
+	void * Memory = std::malloc(sizeof(BlockHeader) + Padding + Size);
+	if (Memory == nullptr)
+		return nullptr;
+	const auto Start   = std::bit_cast<std::uintptr_t>(Memory) + sizeof(BlockHeader);
+	const auto Aligned = (Start + Alignment - 1) & ~(Alignment - 1);
+	const auto Block =
+	    std::construct_at(std::bit_cast<BlockHeader *>(Aligned) - 1,
+	                      BlockHeader{ Size, Memory, metrics::InCharge });
+	metrics::allocated(Block->Owner_, Size);
+	return Block + 1;
+}
+
+void * allocate(std::size_t Size, std::align_val_t Alignment) noexcept {
+	return allocate(Size, std::to_underlying(Alignment));
+}
+
+void release(void * Pointer) noexcept {
+	if (Pointer == nullptr)
+		return;
+	const auto Block = static_cast<BlockHeader *>(Pointer) - 1;
+	metrics::released(Block->Owner_, Block->Size_);
+	std::free(Block->Memory_);
+}
+} // namespace
+
+void * operator new(std::size_t Size) {
+	if (const auto Pointer = allocate(Size))
+		return Pointer;
+	throw std::bad_alloc{};
+}
+void * operator new[](std::size_t Size) {
+	return operator new(Size);
+}
+void * operator new(std::size_t Size, const std::nothrow_t &) noexcept {
+	return allocate(Size);
+}
+void * operator new[](std::size_t Size, const std::nothrow_t &) noexcept {
+	return allocate(Size);
+}
+
+void * operator new(std::size_t Size, std::align_val_t Alignment) {
+	if (const auto Pointer = allocate(Size, Alignment))
+		return Pointer;
+	throw std::bad_alloc{};
+}
+void * operator new[](std::size_t Size, std::align_val_t Alignment) {
+	return operator new(Size, Alignment);
+}
+void * operator new(std::size_t Size, std::align_val_t Alignment,
+                    const std::nothrow_t &) noexcept {
+	return allocate(Size, Alignment);
+}
+void * operator new[](std::size_t Size, std::align_val_t Alignment,
+                      const std::nothrow_t &) noexcept {
+	return allocate(Size, Alignment);
+}
+
+void operator delete(void * Pointer) noexcept {
+	release(Pointer);
+}
+void operator delete[](void * Pointer) noexcept {
+	release(Pointer);
+}
+void operator delete(void * Pointer, std::size_t) noexcept {
+	release(Pointer);
+}
+void operator delete[](void * Pointer, std::size_t) noexcept {
+	release(Pointer);
+}
+void operator delete(void * Pointer, const std::nothrow_t &) noexcept {
+	release(Pointer);
+}
+void operator delete[](void * Pointer, const std::nothrow_t &) noexcept {
+	release(Pointer);
+}
+void operator delete(void * Pointer, std::align_val_t) noexcept {
+	release(Pointer);
+}
+void operator delete[](void * Pointer, std::align_val_t) noexcept {
+	release(Pointer);
+}
+void operator delete(void * Pointer, std::size_t, std::align_val_t) noexcept {
+	release(Pointer);
+}
+void operator delete[](void * Pointer, std::size_t, std::align_val_t) noexcept {
+	release(Pointer);
+}
+void operator delete(void * Pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+	release(Pointer);
+}
+void operator delete[](void * Pointer, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+	release(Pointer);
+}
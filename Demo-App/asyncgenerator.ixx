@@ -0,0 +1,95 @@
+export module asyncgenerator;
+import std;
+
+import asio;
+
+// an asynchronous generator that integrates with Asio coroutines.
+// the producer is an 'asio::awaitable' that may co_await anything in between yielding
+// elements, e.g. i/o, timers, or hops onto other executors. the consumer co_awaits the
+// next element. producer and consumer may run on different executors, e.g. a producer
+// on a thread pool feeding a consumer on the event loop.
+// the elements are handed over through a channel of limited capacity, the producer runs
+// at most that many elements ahead of the consumer. the coroutine frames of both sides
+// are allocated through the recycling allocator of Asio.
+
+namespace aex = asio::experimental;
+namespace executor {
+
+export template <typename T>
+class async_generator {
+	// an empty element marks the end of the sequence
+	using tChannel = aex::concurrent_channel<void(std::error_code, std::optional<T>)>;
+	static constexpr auto asTuple = asio::as_tuple(asio::use_awaitable);
+
+public:
+	using value_type = T;
+
+	// what the producer yields its elements into
+	struct sink {
+		// returns false if the consumer is gone. the producer should end then.
+		auto yield(T Element) const -> asio::awaitable<bool> {
+			auto [Error] = co_await Channel_->async_send(std::error_code{},
+			                                             std::move(Element), asTuple);
+			co_return not Error;
+		}
+
+		// yield all elements of another generator
+		auto yield(std::ranges::elements_of<async_generator &&> Nested) const
+		    -> asio::awaitable<bool> {
+			while (auto Element = co_await Nested.range.next()) {
+				if (not co_await yield(std::move(*Element)))
+					co_return false;
+			}
+			co_return true;
+		}
+
+	private:
+		friend async_generator;
+		std::shared_ptr<tChannel> Channel_;
+	};
+
+	// start the 'Producer' on the given 'Executor', running at most 'Capacity' elements
+	// ahead of the consumer. the producer is called with a sink and the given 'Args'.
+	// an exception that escapes the producer ends the sequence.
+
+	template <typename Producer, typename... Ts>
+	async_generator(const auto & Executor, std::size_t Capacity, Producer && Produce,
+	                Ts &&... Args)
+	: Channel_{ std::make_shared<tChannel>(Executor, Capacity) } {
+		sink Out;
+		Out.Channel_ = Channel_;
+		asio::co_spawn(Executor,
+		               run(std::move(Out), std::forward<Producer>(Produce),
+		                   std::forward<Ts>(Args)...),
+		               [Channel = Channel_](std::exception_ptr) { Channel->close(); });
+	}
+
+	async_generator(async_generator &&) noexcept = default;
+	async_generator & operator=(async_generator && Other) noexcept {
+		std::swap(Channel_, Other.Channel_);
+		return *this;
+	}
+	~async_generator() {
+		if (Channel_)
+			Channel_->close(); // the producer learns about it with its next yield
+	}
+
+	// the next element, nothing at the end of the sequence
+	auto next() -> asio::awaitable<std::optional<T>> {
+		auto [Error, Element] = co_await Channel_->async_receive(asTuple);
+		if (Error)
+			co_return std::nullopt;
+		co_return std::move(Element);
+	}
+
+private:
+	template <typename Producer, typename... Ts>
+	static auto run(sink Out, Producer Produce, Ts... Args) -> asio::awaitable<void> {
+		co_await std::invoke(std::move(Produce), Out, std::move(Args)...);
+		co_await Out.Channel_->async_send(std::error_code{}, std::nullopt, asTuple);
+	}
+
+	std::shared_ptr<tChannel> Channel_;
+};
+
+} // namespace executor
@@ -1,3 +1,13 @@
+module;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#	error this is not POSIX!
+#endif
+
 module the.whole.caboodle;
 import std;
 
@@ -41,10 +51,54 @@ constexpr utf8 decode(utf8 state, char codeunit) {
 	return utf8{ utf8d[256u + state * 16u + type] };
 }
 
-constexpr auto sanitized(std::string_view Input) -> std::string {
-	std::string Result;
-	Result.reserve(Input.size());
+// the length of the longest well-formed prefix of the 'Input'.
+// blocks of pure ASCII are skipped at once, the DFA looks only at the other code units.
+// the block test is branch-free over a couple of machine words such that compilers can
+// vectorize it.
+
+static constexpr std::size_t BlockWords = 4;
+static constexpr std::size_t BlockSize  = BlockWords * sizeof(std::uint64_t);
+
+static bool isASCII(const char * Block) noexcept {
+	std::uint64_t Words[BlockWords];
+	std::memcpy(Words, Block, BlockSize);
+	std::uint64_t Bits = 0;
+	for (const auto Word : Words)
+		Bits |= Word;
+	return (Bits & 0x8080'8080'8080'8080u) == 0;
+}
+
+static auto wellFormedPrefix(std::string_view Input) noexcept -> std::size_t {
+	auto State           = utf8::accept;
+	std::size_t Accepted = 0; // the end of the last complete code point
+	std::size_t Index    = 0;
+	while (Index < Input.size()) {
+		if (State == utf8::accept and Input.size() - Index >= BlockSize and
+		    isASCII(Input.data() + Index)) {
+			Index += BlockSize;
+			Accepted = Index;
+			continue;
+		}
+		State = decode(State, Input[Index++]);
+		if (State == utf8::reject)
+			break;
+		if (State == utf8::accept)
+			Accepted = Index;
+	}
+	return Accepted;
+}
 
+// well-formed input is taken as a whole. the DFA takes care of the rest after the
+// first ill-formed code unit sequence, replacing each of those.
+
+auto sanitized(std::string_view Input) -> std::string {
+	const auto WellFormed = wellFormedPrefix(Input);
+	std::string Result{ Input.substr(0, WellFormed) };
+	if (WellFormed == Input.size())
+		return Result;
+
+	Input.remove_prefix(WellFormed);
+	Result.reserve(WellFormed + Input.size());
 	auto State = utf8::accept;
 	while (!Input.empty()) {
 		uint8_t Length = 0;
@@ -82,4 +136,50 @@ auto utf8Path(const std::filesystem::path & Path) -> std::string {
 	return sanitized(Path.generic_string());
 }
 
+auto mapFile(const std::filesystem::path & Path) -> tMappedFile {
+	const int Handle = ::open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (Handle < 0)
+		return {};
+
+	struct stat Status;
+	std::size_t Size = 0;
+	void * Base      = MAP_FAILED;
+	if (fstat(Handle, &Status) == 0 and Status.st_size > 0) {
+		Size = static_cast<std::size_t>(Status.st_size);
+		Base = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, Handle, 0);
+	}
+	if (Base == MAP_FAILED) {
+		::close(Handle);
+		return {};
+	}
+	posix_madvise(Base, Size, POSIX_MADV_SEQUENTIAL);
+	// the mapping stays valid without the file, but its size must be watched
+	return { static_cast<const std::byte *>(Base), Size, Handle };
+}
+
+void tMappedFile::prefetch(std::size_t Offset, std::size_t Size) const noexcept {
+	static const auto PageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+	if (Offset >= Size_)
+		return;
+	const auto Begin = Offset / PageSize * PageSize;
+	const auto End   = std::min(Offset + Size, Size_);
+	posix_madvise(const_cast<std::byte *>(Base_) + Begin, End - Begin,
+	              POSIX_MADV_WILLNEED);
+}
+
+// a mapped page beyond the end of a truncated file raises SIGBUS when it is touched
+
+bool tMappedFile::holds(std::size_t End) const noexcept {
+	struct stat Status;
+	return End <= Size_ and Handle_ >= 0 and fstat(Handle_, &Status) == 0 and
+	       std::cmp_greater_equal(Status.st_size, End);
+}
+
+void unmapFile(tMappedFile & File) noexcept {
+	if (File.Base_ != nullptr)
+		munmap(const_cast<std::byte *>(File.Base_), File.Size_);
+	if (File.Handle_ >= 0)
+		::close(File.Handle_);
+}
+
 } // namespace caboodle
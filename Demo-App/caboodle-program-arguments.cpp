@@ -5,6 +5,23 @@ import argparse;
 
 namespace caboodle {
 
+using tNamedRole = std::pair<std::string_view, tRole>;
+#if defined(DEMO_SERVER_ONLY)
+static constexpr tNamedRole Roles[] = {
+	{ "server", tRole::server },
+};
+static constexpr auto DefaultRole = "server";
+static constexpr auto RoleHelp    = "run as server, the only role of this build";
+#else
+static constexpr tNamedRole Roles[] = {
+	{ "server", tRole::server },
+	{ "client", tRole::client },
+	{ "both", tRole::both },
+};
+static constexpr auto DefaultRole = "both";
+static constexpr auto RoleHelp    = "run as server, client, or both";
+#endif
+
 auto getOptions(int argc, char * argv[]) -> tOptions {
 	argparse::ArgumentParser Options("Demo application", "",
 	                                 argparse::default_arguments::help, false);
@@ -14,6 +31,56 @@ auto getOptions(int argc, char * argv[]) -> tOptions {
 	Options.add_argument("server", "-s", "--server")
 	    .help("server name or ip")
 	    .default_value("");
+	Options.add_argument("role", "-r", "--role")
+	    .help(RoleHelp)
+	    .default_value(DefaultRole);
+	Options.add_argument("clients", "-c", "--clients")
+	    .help("maximum number of clients, 0 = unlimited")
+	    .default_value(64u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("endpoint-clients", "--endpoint-clients")
+	    .help("maximum number of clients per server endpoint, 0 = unlimited")
+	    .default_value(64u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("egress", "-e", "--egress")
+	    .help("maximum egress in MiB/s, 0 = unlimited")
+	    .default_value(0u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("read-block", "--read-block")
+	    .help("read media files in blocks of this many KiB")
+	    .default_value(64u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("read-ahead", "--read-ahead")
+	    .help("prefetch this many KiB of media files ahead of the reads")
+	    .default_value(1024u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("lookahead", "--lookahead")
+	    .help("open and prime this many media files ahead of the playing one")
+	    .default_value(2u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("watchdog", "-w", "--watchdog")
+	    .help("report event loop stalls longer than this many ms, 0 = off")
+	    .default_value(0u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("mosaic", "--mosaic")
+	    .help("show this many streams in tiles of a single window, 0 = off. a server "
+	          "with default limits admits up to 64 streams")
+	    .default_value(0u)
+	    .scan<'u', unsigned>();
+	Options.add_argument("mosaic-servers", "--mosaic-servers")
+	    .help("comma-separated server names or ips that the tiles of a mosaic stream "
+	          "from in turn, default is the server")
+	    .default_value("");
+	Options.add_argument("capture", "--capture")
+	    .help("capture the received frames into this file")
+	    .default_value("");
+	Options.add_argument("replay", "--replay")
+	    .help("replay the frames from this capture file, no server")
+	    .default_value("");
+	Options.add_argument("max-speed", "--max-speed")
+	    .help("replay as fast as possible")
+	    .default_value(false)
+	    .implicit_value(true);
 
 	bool needHelp = true;
 	try {
@@ -23,13 +90,35 @@ auto getOptions(int argc, char * argv[]) -> tOptions {
 	}
 	if (Options.get("media").contains('?'))
 		needHelp = true;
+	const auto Role = std::ranges::find(Roles, Options.get("role"), &tNamedRole::first);
+	if (Role == std::ranges::end(Roles))
+		needHelp = true;
 
 	if (needHelp) {
 		std::println("{}", Options.help().str());
 		exit(-1);
 	}
-	return { .Media  = std::move(Options).get("media"),
-		     .Server = std::move(Options).get("server") };
+	std::vector<std::string> MosaicServers;
+	const std::string Servers = Options.get("mosaic-servers");
+	for (const auto Name : std::views::split(Servers, ',')) {
+		if (not Name.empty())
+			MosaicServers.emplace_back(std::string_view{ Name });
+	}
+	return { .Media              = std::move(Options).get("media"),
+		     .Server             = std::move(Options).get("server"),
+		     .Role               = Role->second,
+		     .MaxClients         = Options.get<unsigned>("clients"),
+		     .MaxEndpointClients = Options.get<unsigned>("endpoint-clients"),
+		     .MaxEgress          = Options.get<unsigned>("egress"),
+		     .StallThreshold     = Options.get<unsigned>("watchdog"),
+		     .ReadBlock          = Options.get<unsigned>("read-block"),
+		     .ReadAhead          = Options.get<unsigned>("read-ahead"),
+		     .Lookahead          = Options.get<unsigned>("lookahead"),
+		     .Mosaic             = Options.get<unsigned>("mosaic"),
+		     .MosaicServers      = std::move(MosaicServers),
+		     .Capture            = Options.get("capture"),
+		     .Replay             = Options.get("replay"),
+		     .atMaxSpeed         = Options.get<bool>("max-speed") };
 }
 
 } // namespace caboodle
@@ -11,12 +11,41 @@ namespace winapi {
 
 #define APICALL __declspec(dllimport) __stdcall
 
+using HANDLE = void *;
+
+struct MemoryRange {
+	void * VirtualAddress;
+	std::size_t NumberOfBytes;
+};
+
 extern "C" {
 int APICALL WideCharToMultiByte(unsigned, unsigned long, const wchar_t *, int, char *,
                                 int, const char *, int *);
+HANDLE APICALL CreateFileW(const wchar_t *, unsigned long, unsigned long, void *,
+                           unsigned long, unsigned long, HANDLE);
+HANDLE APICALL CreateFileMappingW(HANDLE, void *, unsigned long, unsigned long,
+                                  unsigned long, const wchar_t *);
+void * APICALL MapViewOfFile(HANDLE, unsigned long, unsigned long, unsigned long,
+                             std::size_t);
+int APICALL UnmapViewOfFile(const void *);
+int APICALL GetFileSizeEx(HANDLE, long long *);
+int APICALL CloseHandle(HANDLE);
+HANDLE APICALL GetCurrentProcess();
+int APICALL PrefetchVirtualMemory(HANDLE, std::size_t, MemoryRange *, unsigned long);
 }
 static constexpr auto UTF8 = 65001;
 
+static constexpr unsigned long GenericRead     = 0x8000'0000;
+static constexpr unsigned long ShareReadDelete = 0x0000'0005;
+static constexpr unsigned long OpenExisting    = 3;
+static constexpr unsigned long AttributeNormal = 0x0000'0080;
+static constexpr unsigned long PageReadOnly    = 0x0000'0002;
+static constexpr unsigned long FileMapRead     = 0x0000'0004;
+
+static inline bool isValid(HANDLE Handle) noexcept {
+	return Handle != nullptr and Handle != reinterpret_cast<HANDLE>(-1);
+}
+
 static inline auto estimateNarrowSize(std::wstring_view U16) noexcept -> std::size_t {
 	return WideCharToMultiByte(UTF8, 0, U16.data(), static_cast<int>(U16.size()), nullptr,
 	                           0, nullptr, nullptr);
@@ -50,4 +79,45 @@ auto utf8Path(const std::filesystem::path & Path) -> std::string {
 	return winapi::toUTF8(Path.wstring());
 }
 
+auto mapFile(const std::filesystem::path & Path) -> tMappedFile {
+	using namespace winapi;
+	const auto File = CreateFileW(Path.c_str(), GenericRead, ShareReadDelete, nullptr,
+	                              OpenExisting, AttributeNormal, nullptr);
+	if (not isValid(File))
+		return {};
+
+	long long Size = 0;
+	void * Base    = nullptr;
+	if (GetFileSizeEx(File, &Size) and Size > 0) {
+		if (const auto Mapping =
+		        CreateFileMappingW(File, nullptr, PageReadOnly, 0, 0, nullptr)) {
+			Base = MapViewOfFile(Mapping, FileMapRead, 0, 0, 0);
+			CloseHandle(Mapping); // the view stays valid
+		}
+	}
+	CloseHandle(File);
+	if (Base == nullptr)
+		return {};
+	return { static_cast<const std::byte *>(Base), static_cast<std::size_t>(Size) };
+}
+
+void tMappedFile::prefetch(std::size_t Offset, std::size_t Size) const noexcept {
+	if (Offset >= Size_)
+		return;
+	winapi::MemoryRange Range{ const_cast<std::byte *>(Base_) + Offset,
+		                       std::min(Size, Size_ - Offset) };
+	winapi::PrefetchVirtualMemory(winapi::GetCurrentProcess(), 1, &Range, 0);
+}
+
+// files with a mapped view can't be truncated on Windows
+
+bool tMappedFile::holds(std::size_t End) const noexcept {
+	return End <= Size_;
+}
+
+void unmapFile(tMappedFile & File) noexcept {
+	if (File.Base_ != nullptr)
+		winapi::UnmapViewOfFile(File.Base_);
+}
+
 } // namespace caboodle
@@ -5,11 +5,78 @@ namespace caboodle {
 
 export auto utf8Path(const std::filesystem::path & Path) -> std::string;
 
-struct tOptions {
+// the roles that an instance of the application takes on
+export enum class tRole : unsigned char {
+	server = 1,
+	client = 2,
+	both   = server | client,
+};
+
+export constexpr bool has(tRole Role, tRole Part) noexcept {
+	return (std::to_underlying(Role) & std::to_underlying(Part)) != 0;
+}
+
+export struct tOptions {
 	std::string Media;
 	std::string Server;
+	tRole Role                  = tRole::both;
+	unsigned MaxClients         = 0; // zero means 'unlimited'
+	unsigned MaxEndpointClients = 0;
+	unsigned MaxEgress          = 0; // MiB per second
+	unsigned StallThreshold     = 0; // milliseconds, zero means 'no watchdog'
+	unsigned ReadBlock          = 0; // KiB per read from a media file
+	unsigned ReadAhead          = 0; // KiB prefetched ahead of the reads
+	unsigned Lookahead          = 0; // media files primed ahead of the playing one
+	unsigned Mosaic             = 0; // streams in one window, zero means 'one window'
+	std::vector<std::string> MosaicServers; // the tiles take turns, 'Server' if none
+	std::string Capture;             // file to capture the received frames into
+	std::string Replay;              // file to replay captured frames from
+	bool atMaxSpeed             = false;
 };
 
 export auto getOptions(int argc, char * argv[]) -> tOptions;
 
+// a read-only view of the contents of a file that is mapped into memory.
+// the view is empty if the file can't be mapped. it is meant to be read sequentially,
+// and parts of it can be prefetched from storage ahead of time without blocking.
+// the file may shrink while it is mapped. touching the view beyond the end of the file
+// is fatal then, so readers of files that may change check before they read.
+
+export struct tMappedFile {
+	tMappedFile() noexcept = default;
+	tMappedFile(const std::byte * Base, std::size_t Size, int Handle = -1) noexcept
+	: Base_{ Base }
+	, Size_{ Size }
+	, Handle_{ Handle } {}
+	tMappedFile(tMappedFile && Other) noexcept
+	: Base_{ std::exchange(Other.Base_, nullptr) }
+	, Size_{ std::exchange(Other.Size_, 0) }
+	, Handle_{ std::exchange(Other.Handle_, -1) } {}
+	tMappedFile & operator=(tMappedFile && Other) noexcept {
+		std::swap(Base_, Other.Base_);
+		std::swap(Size_, Other.Size_);
+		std::swap(Handle_, Other.Handle_);
+		return *this;
+	}
+	~tMappedFile();
+
+	[[nodiscard]] auto bytes() const noexcept -> std::span<const std::byte> {
+		return { Base_, Size_ };
+	}
+	void prefetch(std::size_t Offset, std::size_t Size) const noexcept;
+	// the file still holds the view up to 'End'
+	[[nodiscard]] bool holds(std::size_t End) const noexcept;
+
+	const std::byte * Base_ = nullptr;
+	std::size_t Size_       = 0;
+	int Handle_             = -1; // of the file where it may shrink while mapped
+};
+
+export auto mapFile(const std::filesystem::path & Path) -> tMappedFile;
+void unmapFile(tMappedFile & File) noexcept;
+
+tMappedFile::~tMappedFile() {
+	unmapFile(*this);
+}
+
 } // namespace caboodle
@@ -6,12 +6,30 @@ import net;
 import gui;
 import video;
 import executor;
+import inprocess;
+import metrics;
+import sharedmemory;
+import protocol;
+
+import :capture;
 
 using namespace std::chrono_literals;
+namespace rgs = std::ranges;
 
 namespace client {
 static constexpr auto ReceiveTimeBudget = 2s;
 static constexpr auto ConnectTimeBudget = 2s;
+static constexpr auto FrameCacheBudget  = 64u * 1024; // KiB
+static constexpr std::chrono::milliseconds FirstRetryDelay = 100ms;
+static constexpr std::chrono::milliseconds MaxRetryDelay   = 5s;
+static constexpr auto ClockProbePeriod = 1s;
+static constexpr auto ClockSamples     = 8u;
+
+// the features that this client supports
+static constexpr protocol::tFeatures Offered =
+    protocol::Resume | protocol::ContentCache | protocol::Downscale |
+    protocol::Batching | protocol::FormatRGBA | protocol::FormatBGRA |
+    protocol::LatencyProbe;
 
 // a memory resource that owns at least as much memory as it was ever asked to lend out.
 
@@ -29,49 +47,339 @@ private:
 	std::size_t Capacity_ = 0;
 };
 
+// the pixels of frames from the network are kept around for later reuse. a server that
+// keeps sending the same frames over and over sends only their hashes after a while.
+// the pixels are kept together with their size, a frame that refers to them must have
+// the same.
+
+struct CachedPixels {
+	std::unique_ptr<std::byte[]> Bytes_;
+	std::size_t Size_;
+};
+
+struct FrameCache : protocol::ContentCache<CachedPixels> {
+	using ContentCache::ContentCache;
+
+	// lend memory that the cache takes over once the pixels have arrived, if it is going
+	// to take them at all
+	[[nodiscard]] auto lend(const protocol::ContentTag & Tag, std::size_t Size,
+	                        AdaptiveMemoryResource & Memory) -> net::tByteSpan {
+		Arriving_.reset();
+		if (not accepts(Tag.Hash_, Size))
+			return Memory.lend(Size);
+		Arriving_ = std::make_unique_for_overwrite<std::byte[]>(Size);
+		return { Arriving_.get(), Size };
+	}
+
+	// the lent memory holds all pixels now
+	void keep(const protocol::ContentTag & Tag, std::size_t Size) {
+		if (Arriving_)
+			insert(Tag.Hash_, Size, { std::move(Arriving_), Size });
+	}
+
+	// nothing if the pixels are unknown, or if they don't match the frame
+	[[nodiscard]] auto pixelsOf(const protocol::ContentTag & Tag, std::size_t Size)
+	    -> std::optional<video::tPixels> {
+		const auto * Pixels = find(Tag.Hash_);
+		if (Pixels == nullptr or Pixels->Size_ != Size)
+			return std::nullopt;
+		return video::tPixels{ Pixels->Bytes_.get(), Size };
+	}
+
+private:
+	std::unique_ptr<std::byte[]> Arriving_;
+};
+
+// batched frames arrive back-to-back. the small pieces like headers and tags are
+// taken from a buffer that is filled with as many bytes as the socket has at hand,
+// saving a system call per piece. large pieces go directly into their final place.
+
+struct ReadAhead {
+	static constexpr auto Capacity = 64u << 10; // bytes
+
+	auto receive(net::tSocket & Socket, net::tTimer & Timer, net::tByteSpan Target)
+	    -> asio::awaitable<net::tExpectSize> {
+		const auto Size     = Target.size();
+		const auto Buffered = std::min(Size, Filled_.size());
+		rgs::copy(Filled_.first(Buffered), Target.begin());
+		Filled_ = Filled_.subspan(Buffered);
+		Target  = Target.subspan(Buffered);
+
+		while (not Target.empty()) {
+			if (Target.size() >= Capacity) {
+				auto Got = co_await net::receiveFrom(Socket, Timer, Target);
+				co_return net::replace(std::move(Got), Size);
+			}
+			if (not Bytes_)
+				Bytes_ = std::make_unique_for_overwrite<std::byte[]>(Capacity);
+			const net::tByteSpan Space{ Bytes_.get(), Capacity };
+			const auto Got = co_await net::receiveSome(Socket, Timer, Space);
+			if (not Got)
+				co_return Got;
+			const auto Taken = std::min(Target.size(), *Got);
+			rgs::copy(Space.first(Taken), Target.begin());
+			Filled_ = Space.subspan(Taken, *Got - Taken);
+			Target  = Target.subspan(Taken);
+		}
+		co_return Size;
+	}
+
+private:
+	std::unique_ptr<std::byte[]> Bytes_;
+	net::tByteSpan Filled_;
+};
+
+// the offset of the server's clock from the client's, estimated the NTP way from the
+// answers to clock probes. of the most recent samples, the one with the shortest round
+// trip wins. its offset is the least affected by queueing along the way.
+
+struct ClockOffset {
+	using tClockTime = protocol::tClockTime;
+
+	// a probe that the client has sent at 'Probed', the server has received at
+	// 'Received' and answered at 'Answered', and the answer has arrived at 'Arrived'
+	void sample(tClockTime Probed, tClockTime Received, tClockTime Answered,
+	            tClockTime Arrived) noexcept {
+		auto & Sample     = Samples_[Taken_++ % ClockSamples];
+		Sample.Offset_    = ((Received - Probed) + (Answered - Arrived)) / 2;
+		Sample.RoundTrip_ = (Arrived - Probed) - (Answered - Received);
+	}
+
+	// add the offset to a time on the client's clock to get the one on the server's
+	[[nodiscard]] auto estimate() const noexcept -> std::optional<tClockTime> {
+		if (Taken_ == 0)
+			return std::nullopt;
+		const auto Taken = std::span{ Samples_ }.first(std::min(Taken_, Samples_.size()));
+		return rgs::min(Taken, {}, &Sample::RoundTrip_).Offset_;
+	}
+
+private:
+	struct Sample {
+		tClockTime Offset_;
+		tClockTime RoundTrip_;
+	};
+	std::array<Sample, ClockSamples> Samples_{};
+	std::size_t Taken_ = 0;
+};
+
+// the latencies of the frames from decoding on the server to presenting on the client,
+// per stage. the times on the server come with the frame trailers. the stages that
+// span both sides are recorded only once there is an estimate of the clock offset.
+// recording takes a few atomic additions per frame, it is cheap enough to be always on.
+
+struct Latencies {
+	Latencies()
+	: DecodeToSend_{ metrics::histogram("latency 1: decode to send") }
+	, SendToReceive_{ metrics::histogram("latency 2: send to receive") }
+	, ReceiveToPresent_{ metrics::histogram("latency 3: receive to present") }
+	, DecodeToPresent_{ metrics::histogram("latency: decode to present") } {}
+
+	void record(const protocol::FrameTrailer & Trailer, Clock::time_point Arrived,
+	            Clock::time_point Received, Clock::time_point Presented) {
+		using protocol::clockTime, std::chrono::duration_cast, std::chrono::microseconds;
+		// the first trailer with a new answer went out first, with the least delay
+		if (Trailer.Probed_ != protocol::tClockTime{ 0 } and Trailer.Probed_ != Probed_) {
+			Probed_ = Trailer.Probed_;
+			Offset_.sample(Trailer.Probed_, Trailer.Received_, Trailer.Sent_,
+			               clockTime(Arrived));
+		}
+		DecodeToSend_.record(Trailer.Sent_ - Trailer.Decoded_);
+		ReceiveToPresent_.record(duration_cast<microseconds>(Presented - Received));
+
+		const auto Offset = Offset_.estimate();
+		if (not Offset)
+			return;
+		SendToReceive_.record(clockTime(Received) + *Offset - Trailer.Sent_);
+		DecodeToPresent_.record(clockTime(Presented) + *Offset - Trailer.Decoded_);
+	}
+
+	// clients probe the clock of the server every now and then
+	[[nodiscard]] bool isProbeDue(Clock::time_point Now) noexcept {
+		if (Now < NextProbe_)
+			return false;
+		NextProbe_ = Now + ClockProbePeriod;
+		return true;
+	}
+
+private:
+	ClockOffset Offset_;
+	protocol::tClockTime Probed_{ 0 };
+	Clock::time_point NextProbe_;
+	metrics::Histogram & DecodeToSend_;
+	metrics::Histogram & SendToReceive_;
+	metrics::Histogram & ReceiveToPresent_;
+	metrics::Histogram & DecodeToPresent_;
+};
+
+// everything that it takes to receive frames: the negotiated terms, memory for the
+// pixels, and the bytes that were read ahead. on connections with latency probes, the
+// trailer of the most recent frame, and the time when its header has arrived.
+
+struct Reception {
+	Reception(const protocol::Welcome & Terms, std::uint32_t CacheBudget)
+	: Terms_{ Terms }
+	, Cache_{ Terms.has(protocol::ContentCache) ? CacheBudget * 1024ull : 0u } {}
+
+	[[nodiscard]] bool isProbing() const noexcept {
+		return Terms_.has(protocol::LatencyProbe);
+	}
+
+	protocol::Welcome Terms_;
+	AdaptiveMemoryResource Memory_;
+	FrameCache Cache_;
+	ReadAhead Ahead_;
+	std::optional<protocol::FrameTrailer> Trailer_;
+	Clock::time_point Arrived_;
+	Latencies Latency_;
+};
+
+// frame headers from the network come in the negotiated version.
+
+[[nodiscard]] auto receiveHeader(net::tSocket & Socket, net::tTimer & Timer,
+                                 Reception & In)
+    -> asio::awaitable<std::optional<video::FrameHeader>> {
+	using video::FrameHeader, video::FrameHeaderV1;
+	if (In.Terms_.hasCompactHeaders()) {
+		alignas(FrameHeaderV1) std::byte Bytes[FrameHeaderV1::SizeBytes];
+		if (co_await In.Ahead_.receive(Socket, Timer, Bytes) == sizeof(Bytes))
+			co_return video::widened(*std::start_lifetime_as<FrameHeaderV1>(Bytes));
+	} else {
+		alignas(FrameHeader) std::byte Bytes[FrameHeader::SizeBytes];
+		if (co_await In.Ahead_.receive(Socket, Timer, Bytes) == sizeof(Bytes))
+			co_return *std::start_lifetime_as<FrameHeader>(Bytes);
+	}
+	co_return std::nullopt;
+}
+
+// frames from the network may come with a content tag. in that case their pixels may
+// be taken from the cache.
+
+[[nodiscard]] auto receiveContent(net::tSocket & Socket, net::tTimer & Timer,
+                                  Reception & In) -> asio::awaitable<video::Frame> {
+	const auto Header = co_await receiveHeader(Socket, Timer, In);
+	if (not Header)
+		co_return video::noFrame;
+	In.Arrived_ = Clock::now();
+
+	protocol::ContentTag Tag;
+	if (In.Cache_.isEnabled()) {
+		const auto TagBytes = std::as_writable_bytes(std::span{ &Tag, 1 });
+		if (co_await In.Ahead_.receive(Socket, Timer, TagBytes) != TagBytes.size())
+			co_return video::noFrame;
+	}
+	if (Tag.Pixels_ == protocol::ContentTag::Cached) {
+		const auto Pixels = In.Cache_.pixelsOf(Tag, Header->SizePixels());
+		co_return Pixels ? video::Frame{ *Header, *Pixels } : video::noFrame;
+	}
+
+	auto Pixels = In.Cache_.lend(Tag, Header->SizePixels(), In.Memory_);
+	if (not Pixels.empty()) {
+		const auto Got = co_await In.Ahead_.receive(Socket, Timer, Pixels);
+		Pixels         = Pixels.first(Got.value_or(0));
+	}
+	if (Pixels.size() != Header->SizePixels())
+		co_return video::noFrame;
+	In.Cache_.keep(Tag, Pixels.size());
+	co_return video::Frame{ *Header, Pixels };
+}
+
 // receive a single video frame.
 // it returns either
 //  - a well-formed frame with visible content
 //  - a well-formed frame without visible content
 //  - a 'noFrame' placeholder to express disappointment in case of problems
+// on connections with latency probes, a trailer follows each frame.
 
 [[nodiscard]] auto receiveFrame(net::tSocket & Socket, net::tTimer & Timer,
-                                AdaptiveMemoryResource & Memory)
+                                Reception & In) -> asio::awaitable<video::Frame> {
+	const auto Frame = co_await receiveContent(Socket, Timer, In);
+	if (not In.isProbing() or Frame.Header_.isNoFrame())
+		co_return Frame;
+
+	protocol::FrameTrailer Trailer;
+	const auto Bytes = std::as_writable_bytes(std::span{ &Trailer, 1 });
+	if (co_await In.Ahead_.receive(Socket, Timer, Bytes) != Bytes.size())
+		co_return video::noFrame;
+	In.Trailer_ = Trailer;
+	co_return Frame;
+}
+
+// frames from within the same process come with their pixels attached.
+
+[[nodiscard]] auto receiveFrame(inprocess::tConnection & Connection, net::tTimer & Timer,
+                                Reception &)
     -> asio::awaitable<video::Frame> {
-	alignas(video::FrameHeader) std::byte HeaderBytes[video::FrameHeader::SizeBytes];
+	auto Frame = co_await inprocess::receiveFrom(Connection, Timer);
+	co_return std::move(Frame).value_or(video::noFrame);
+}
 
-	auto Got = co_await net::receiveFrom(Socket, Timer, HeaderBytes);
-	if (Got == video::FrameHeader::SizeBytes) {
-		const auto & Header = *std::start_lifetime_as<video::FrameHeader>(HeaderBytes);
+// frames from the same host come with their pixels in shared memory.
 
-		auto Pixels = Memory.lend(Header.SizePixels());
-		if (not Pixels.empty()) {
-			Got    = co_await net::receiveFrom(Socket, Timer, Pixels);
-			Pixels = Pixels.first(Got.value_or(0));
-		}
-		if (Pixels.size() == Header.SizePixels())
-			co_return video::Frame{ Header, Pixels };
-	}
-	co_return video::noFrame;
+[[nodiscard]] auto receiveFrame(shm::tConnection & Connection, net::tTimer & Timer,
+                                Reception &)
+    -> asio::awaitable<video::Frame> {
+	auto Frame = co_await shm::receiveFrom(Connection, Timer);
+	co_return std::move(Frame).value_or(video::noFrame);
+}
+
+// frames from a replay come from a capture file.
+
+[[nodiscard]] auto receiveFrame(Replay & Source, net::tTimer & Timer, Reception &)
+    -> asio::awaitable<video::Frame> {
+	auto Frame = co_await client::receiveFrom(Source, Timer);
+	co_return std::move(Frame).value_or(video::noFrame);
+}
+
+// clients probe the clock of the server through network connections only.
+
+[[nodiscard]] auto probeClock(net::tSocket & Socket, net::tTimer & Timer)
+    -> asio::awaitable<bool> {
+	const protocol::ClockProbe Probe{ .Sent_ = protocol::clockTime(Clock::now()) };
+	net::tSendBuffers<1> Buffers{ net::asBytes(Probe) };
+	const auto Sent = co_await net::sendTo(Socket, Timer, Buffers);
+	co_return Sent == protocol::ClockProbe::SizeBytes;
+}
+
+[[nodiscard]] auto probeClock(auto &, net::tTimer &) -> asio::awaitable<bool> {
+	co_return true;
 }
 
 // present a possibly infinite sequence of video frames until the spectator
 // gets bored or problems arise.
+// the frames come under the given 'Terms'. the last presented frame is remembered in
+// the 'Hello' for the next connection. all received frames go into the 'Capture'.
+// the frames are presented in a window, or in a tile of a mosaic. the latencies of the
+// frames are recorded if the connection probes them.
+// returns if there was anything to present at all.
 
-[[nodiscard]] auto rollVideos(net::tSocket Socket, net::tTimer Timer,
-                              gui::FancyWindow Window) -> asio::awaitable<void> {
-	const auto WatchDog = executor::abort(Socket, Timer);
-	AdaptiveMemoryResource PixelMemory;
+[[nodiscard]] auto rollVideos(auto Connection, const protocol::Welcome & Terms,
+                              net::tTimer & Timer, auto & Window, protocol::Hello & Hello,
+                              Recorder & Capture) -> asio::awaitable<bool> {
+	const auto WatchDog = executor::abort(Connection, Timer);
+	Reception In{ Terms, Hello.CacheBudget_ };
+	bool hasPresented = false;
 
-	while (Socket.is_open()) {
+	while (Connection.is_open()) {
 		Timer.expires_after(ReceiveTimeBudget);
-		const auto Frame    = co_await receiveFrame(Socket, Timer, PixelMemory);
+		const auto Frame    = co_await receiveFrame(Connection, Timer, In);
+		const auto Received = Clock::now();
 		const auto & Header = Frame.Header_;
 		if (Header.isNoFrame())
 			break;
 
+		Capture.record(Frame);
 		Window.updateFrom(Header);
 		Window.present(Frame.Pixels_);
+		metrics::countFrame(metrics::Passage::presented);
+		if (In.Trailer_) {
+			const auto Presented = Clock::now();
+			In.Latency_.record(*In.Trailer_, In.Arrived_, Received, Presented);
+			if (In.Latency_.isProbeDue(Presented) and
+			    not co_await probeClock(Connection, Timer))
+				break;
+		}
+		Hello.presented(Header);
+		hasPresented = true;
 
 		using namespace std::chrono;
 
@@ -81,19 +389,191 @@ private:
 			std::println("frame {:3} {}x{} @ {:>6%Q%q}", Header.Sequence_, Header.Width_,
 			             Header.Height_, round<milliseconds>(Header.Timestamp_));
 	}
+	co_return hasPresented;
 }
 
-// connects to the server and starts the top-level video receive-render-present loop.
-// initiates an application stop in case of communication problems.
+// servers on the same host are reachable through an AF_UNIX socket, too. only a server
+// that runs as the same user is trusted.
 
-export [[nodiscard]] auto showVideos(asio::io_context & Context, gui::FancyWindow Window,
-                                     net::tEndpoints Endpoints) -> asio::awaitable<void> {
-	net::tTimer Timer(Context);
+[[nodiscard]] auto connectLocally(net::tEndpoints Endpoints, net::tTimer & Timer)
+    -> asio::awaitable<net::tExpectLocalSocket> {
+	if (not shm::isSupported() or not rgs::any_of(Endpoints, net::isOnThisHost))
+		co_return std::unexpected{ std::make_error_code(std::errc::not_supported) };
+	const auto Endpoint = net::localEndpoint(net::tPort{ Endpoints.front().port() });
+	if (not Endpoint)
+		co_return std::unexpected{ Endpoint.error() };
+	auto Socket = co_await net::connectTo(*Endpoint, Timer);
+	if (Socket and not net::isOwnUser(*Socket))
+		co_return std::unexpected{ std::make_error_code(std::errc::permission_denied) };
+	co_return Socket;
+}
+
+// greet the server right after connecting through a socket, and learn about the terms
+// of the connection.
+
+[[nodiscard]] auto handshake(auto & Socket, net::tTimer & Timer,
+                             const protocol::Hello & Hello)
+    -> asio::awaitable<std::optional<protocol::Welcome>> {
+	net::tSendBuffers<1> Buffers{ net::asBytes(Hello) };
+	if (co_await net::sendTo(Socket, Timer, Buffers) != protocol::Hello::SizeBytes)
+		co_return std::nullopt;
+
+	protocol::Welcome Terms;
+	const auto Bytes = std::as_writable_bytes(std::span{ &Terms, 1 });
+	if (co_await net::receiveFrom(Socket, Timer, Bytes) != Bytes.size() or
+	    not Terms.isValid())
+		co_return std::nullopt;
+	co_return Terms;
+}
+
+// connects to the server and runs the video receive-render-present loop for as long as
+// the connection lasts.
+// the cheapest transport wins: a server within the same process is connected to
+// directly, one on the same host through shared memory, all others through tcp.
+// the same-host transport falls back to tcp if anything goes wrong before the first
+// frame is presented.
+// returns if there was anything to present at all.
+
+[[nodiscard]] auto connectAndRoll(asio::io_context & Context, auto & Window,
+                                  net::tEndpoints Endpoints, net::tTimer & Timer,
+                                  protocol::Hello & Hello, Recorder & Capture)
+    -> asio::awaitable<bool> {
 	Timer.expires_after(ConnectTimeBudget);
+	if (auto Connection = inprocess::connectTo(Context, Endpoints, Hello)) {
+		co_return co_await rollVideos(std::move(Connection).value(), protocol::Welcome{},
+		                              Timer, Window, Hello, Capture);
+	}
+	if (auto Local = co_await connectLocally(Endpoints, Timer)) {
+		shm::tConnection Connection{ std::move(Local).value() };
+		const auto Terms = co_await handshake(Connection.Socket_, Timer, Hello);
+		if (Terms and co_await rollVideos(std::move(Connection), *Terms, Timer, Window,
+		                                  Hello, Capture))
+			co_return true;
+		Timer.expires_after(ConnectTimeBudget);
+	}
 	if (net::tExpectSocket Socket = co_await net::connectTo(Endpoints, Timer)) {
-		co_await rollVideos(std::move(Socket).value(), std::move(Timer),
-		                    std::move(Window));
+		if (const auto Terms = co_await handshake(Socket.value(), Timer, Hello))
+			co_return co_await rollVideos(std::move(Socket).value(), *Terms, Timer,
+			                              Window, Hello, Capture);
+	}
+	co_return false;
+}
+
+// the delays between reconnection attempts grow exponentially up to a limit. they are
+// jittered to keep a crowd of clients from retrying in lockstep after a server restart.
+
+struct Backoff {
+	explicit Backoff(std::uint32_t Seed)
+	: Random_{ Seed } {}
+
+	void reset() noexcept { Ceiling_ = FirstRetryDelay; }
+	auto next() -> std::chrono::milliseconds {
+		using tJitter = std::uniform_int_distribution<std::chrono::milliseconds::rep>;
+		const auto Ceiling = Ceiling_.count();
+		const auto Delay   = tJitter{ Ceiling / 2, Ceiling }(Random_);
+		Ceiling_           = std::min(2 * Ceiling_, MaxRetryDelay);
+		return std::chrono::milliseconds{ Delay };
+	}
+
+private:
+	std::minstd_rand Random_;
+	std::chrono::milliseconds Ceiling_ = FirstRetryDelay;
+};
+
+// show the videos from the server in the given window until the application stops.
+// lost connections are reestablished after a while. the window stays as it is in the
+// meantime, and the server resumes playback right after the last presented frame.
+// the received frames are captured into the given file, if any. the pixels of at most
+// 'CacheBudget' KiB are kept for reuse. the stream holds on to its own copy of the
+// endpoints.
+
+template <typename Window>
+[[nodiscard]] auto streamInto(asio::io_context & Context, Window Target,
+                              const std::vector<net::tEndpoint> Endpoints,
+                              std::uint32_t CacheBudget,
+                              const std::filesystem::path CaptureFile)
+    -> asio::awaitable<void> {
+	const auto Stop = executor::StopAssetOf(Context);
+	std::random_device Entropy;
+	protocol::Hello Hello{ .Features_    = Offered,
+		                   .Session_     = Entropy() | 1u,
+		                   .CacheBudget_ = CacheBudget };
+	Backoff Delay{ Entropy() };
+	Recorder Capture{ CaptureFile };
+	net::tTimer Timer(Context);
+
+	while (not Stop.stop_requested()) {
+		const auto Viewport   = Target.viewport();
+		Hello.ViewportWidth_  = Viewport.Width;
+		Hello.ViewportHeight_ = Viewport.Height;
+		const bool hasPresented =
+		    co_await connectAndRoll(Context, Target, Endpoints, Timer, Hello, Capture);
+		if (hasPresented)
+			Delay.reset();
+
+		Timer.expires_after(Delay.next());
+		const auto WatchDog = executor::abort(Timer);
+		co_await Timer.async_wait();
 	}
-	executor::StopAssetOf(Context).request_stop();
+}
+
+export [[nodiscard]] auto showVideos(asio::io_context & Context, gui::FancyWindow Window,
+                                     net::tEndpoints Endpoints,
+                                     std::filesystem::path CaptureFile)
+    -> asio::awaitable<void> {
+	return streamInto(Context, std::move(Window), { Endpoints.begin(), Endpoints.end() },
+	                  FrameCacheBudget, std::move(CaptureFile));
+}
+
+// show as many streams as there are 'Tiles' in a single mosaic window until the
+// application stops. each stream takes a tile, and a share of the frame cache. the
+// tiles take turns in streaming from the servers at the given 'Sources'. the streams
+// are scaled down to the size of their tiles by the servers.
+// the mosaic is presented once per display refresh if anything has changed.
+
+export [[nodiscard]] auto showMosaic(asio::io_context & Context,
+                                     gui::tDimensions Dimensions, unsigned Tiles,
+                                     std::vector<std::vector<net::tEndpoint>> Sources)
+    -> asio::awaitable<void> {
+	const auto Mosaic = std::make_shared<gui::Mosaic>(Dimensions, Tiles);
+	for (auto Index = 0u; Index < Tiles; ++Index)
+		executor::commission(Context, streamInto<gui::Tile>, Context,
+		                     gui::Tile{ Mosaic, Index }, Sources[Index % Sources.size()],
+		                     FrameCacheBudget / Tiles, std::filesystem::path{});
+
+	net::tTimer Timer(Context);
+	const auto WatchDog = executor::abort(Timer);
+	const auto Interval = Mosaic->refreshInterval();
+	auto Due            = Clock::now();
+	do {
+		Mosaic->present();
+		Due = std::max(Due + Interval, Clock::now());
+		Timer.expires_at(Due);
+	} while (co_await net::expired(Timer));
+}
+
+// show the videos from the given capture file without any server. frames are presented
+// at the pace of their recorded arrival, or as fast as possible.
+
+export [[nodiscard]] auto replayVideos(asio::io_context & Context,
+                                       gui::FancyWindow Window,
+                                       const std::filesystem::path CaptureFile,
+                                       bool atMaxSpeed) -> asio::awaitable<void> {
+	Replay Source{ CaptureFile, atMaxSpeed };
+	const auto Frames = Source.frames();
+	if (not Source.is_open()) {
+		std::println("no frames captured in {}", CaptureFile.string());
+		co_return;
+	}
+
+	net::tTimer Timer(Context);
+	protocol::Hello Hello;
+	Recorder None;
+	const auto Start = Clock::now();
+	co_await rollVideos(std::move(Source), protocol::Welcome{}, Timer, Window, Hello,
+	                    None);
+	const auto Elapsed = Clock::now() - Start;
+	using std::chrono::round, std::chrono::milliseconds;
+	std::println("replayed {} frames in {}", Frames, round<milliseconds>(Elapsed));
 }
 } // namespace client
@@ -0,0 +1,153 @@
+export module client:capture;
+import std;
+
+import asio;
+import net;
+import the.whole.caboodle;
+import video;
+
+// capture the frames that a client receives into a file, and replay them later without
+// any server at all. replays make the client side reproducible, e.g. for benchmarking
+// and profiling the conversion and presentation of frames on identical traffic.
+
+namespace fs = std::filesystem;
+
+namespace client {
+using Clock    = std::chrono::steady_clock;
+using µSeconds = std::chrono::duration<std::int64_t, std::micro>;
+
+static constexpr std::uint32_t CaptureMagic   = 0x50'41'43'56; // "VCAP"
+static constexpr std::uint32_t CaptureVersion = 2;
+static constexpr std::size_t RecordAlignment  = 8;
+
+// a capture file starts with a header, followed by a record per frame in the order of
+// their arrival. the pixels of a frame follow its record, padded to the alignment of
+// the records. the frames are complete, i.e. cached contents are resolved.
+
+struct CaptureHeader {
+	std::uint32_t Magic_   = CaptureMagic;
+	std::uint32_t Version_ = CaptureVersion;
+};
+static_assert(sizeof(CaptureHeader) == RecordAlignment);
+
+struct CaptureRecord {
+	std::int64_t Arrival_; // since the start of the capture
+	video::FrameHeader Header_;
+};
+static_assert(sizeof(CaptureRecord) % RecordAlignment == 0);
+static_assert(std::is_trivially_copyable_v<CaptureRecord>,
+              "Please keep me trivially copyable"); // guarantee relocatability!
+
+constexpr auto padded(std::size_t Size) noexcept -> std::size_t {
+	return (Size + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+}
+
+// the recorder taps the frames as they come in. a recorder without a file is idle.
+
+export struct Recorder {
+	Recorder() = default;
+	explicit Recorder(const fs::path & Path) {
+		if (Path.empty())
+			return;
+		File_.open(Path, std::ios::binary | std::ios::trunc);
+		write(CaptureHeader{});
+	}
+
+	[[nodiscard]] bool isEnabled() const noexcept { return File_.is_open(); }
+
+	void record(const video::Frame & Frame) {
+		if (not isEnabled())
+			return;
+		using std::chrono::duration_cast;
+		const auto Arrival = duration_cast<µSeconds>(Clock::now() - Start_);
+		const auto Pixels  = Frame.Pixels_.first(Frame.Header_.SizePixels());
+		write(CaptureRecord{ .Arrival_ = Arrival.count(), .Header_ = Frame.Header_ });
+		File_.write(reinterpret_cast<const char *>(Pixels.data()),
+		            static_cast<std::streamsize>(Pixels.size()));
+		static constexpr char Padding[RecordAlignment] = {};
+		File_.write(Padding, static_cast<std::streamsize>(padded(Pixels.size()) -
+		                                                   Pixels.size()));
+	}
+
+private:
+	void write(const auto & Object) {
+		File_.write(reinterpret_cast<const char *>(&Object), sizeof(Object));
+	}
+
+	std::ofstream File_;
+	Clock::time_point Start_ = Clock::now();
+};
+
+// a replay takes the place of a connection to a server. it presents the frames from a
+// capture file either at the pace of their recorded arrival, or as fast as possible.
+// the pixels of the frames are taken right from the mapped file.
+
+export struct Replay {
+	Replay(const fs::path & Path, bool atMaxSpeed)
+	: File_{ caboodle::mapFile(Path) }
+	, atMaxSpeed_{ atMaxSpeed } {
+		const auto Bytes = File_.bytes();
+		if (Bytes.size() < sizeof(CaptureHeader))
+			return;
+		const auto & Header = *std::start_lifetime_as<CaptureHeader>(Bytes.data());
+		if (Header.Magic_ != CaptureMagic or Header.Version_ != CaptureVersion)
+			return;
+
+		// accept only complete records
+		std::size_t Offset = sizeof(CaptureHeader);
+		while (Bytes.size() - Offset >= sizeof(CaptureRecord)) {
+			const auto Pixels = recordAt(Offset).Header_.SizePixels();
+			const auto Size   = sizeof(CaptureRecord) + padded(Pixels);
+			if (Bytes.size() - Offset < Size)
+				break;
+			Offset += Size;
+			++Frames_;
+		}
+		Records_ = Bytes.subspan(sizeof(CaptureHeader), Offset - sizeof(CaptureHeader));
+	}
+
+	[[nodiscard]] bool is_open() const noexcept { return not Records_.empty(); }
+	void close() noexcept { Records_ = {}; }
+	[[nodiscard]] auto frames() const noexcept { return Frames_; }
+
+	// the next frame, and when to present it
+	auto next() noexcept -> std::pair<video::Frame, Clock::time_point> {
+		const auto Offset   = static_cast<std::size_t>(Records_.data() - File_.Base_);
+		const auto & Record = recordAt(Offset);
+		const auto Size     = Record.Header_.SizePixels();
+		const auto Pixels   = Records_.subspan(sizeof(CaptureRecord), Size);
+		Records_            = Records_.subspan(sizeof(CaptureRecord) + padded(Size));
+		// the next frame is most likely of the same size
+		File_.prefetch(Offset + sizeof(CaptureRecord) + padded(Size), Size);
+
+		const auto Arrival = Start_ + µSeconds{ Record.Arrival_ };
+		return { video::Frame{ Record.Header_, Pixels },
+			     atMaxSpeed_ ? Clock::now() : Arrival };
+	}
+
+private:
+	auto recordAt(std::size_t Offset) const noexcept -> const CaptureRecord & {
+		return *std::start_lifetime_as<CaptureRecord>(File_.Base_ + Offset);
+	}
+
+	caboodle::tMappedFile File_;
+	std::span<const std::byte> Records_;
+	std::size_t Frames_      = 0;
+	Clock::time_point Start_ = Clock::now();
+	bool atMaxSpeed_;
+};
+
+// the frames from a replay come when they are due. even at maximum speed, every frame
+// takes a turn through the event loop to keep the application responsive.
+
+export auto receiveFrom(Replay & Source, net::tTimer & Timer)
+    -> asio::awaitable<std::optional<video::Frame>> {
+	if (not Source.is_open())
+		co_return std::nullopt;
+	auto [Frame, Due] = Source.next();
+	Timer.expires_at(Due);
+	if (not co_await net::expired(Timer))
+		co_return std::nullopt;
+	co_return std::move(Frame);
+}
+} // namespace client
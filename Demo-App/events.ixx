@@ -6,13 +6,11 @@ import std;
 
 import asio;
 import executor;
+#if not defined(DEMO_SERVER_ONLY)
 import gui;
+#endif
 import net;
 
-using namespace std::chrono_literals;
-
-static constexpr auto EventPollInterval = 50ms;
-
 // user interaction
 export namespace handleEvents {
 
@@ -27,17 +25,36 @@ export namespace handleEvents {
 	executor::StopAssetOf(Context).request_stop();
 }
 
+#if not defined(DEMO_SERVER_ONLY)
 // the GUI interaction is a separate coroutine.
 // initiate an application stop if the spectator closes the window.
+// the GUI tells about its events right away, i.e. whenever they are pumped. presenting a
+// frame does that. while no frames are presented, e.g. when the client connects, waits
+// for frames, or backs off, the events are pumped here instead. the windows stay
+// responsive then, and a playing client sees no more than a cheap timer wake-up.
+
+static constexpr auto EventLatency = std::chrono::milliseconds{ 50 };
 
 [[nodiscard]] auto fromGUI(asio::io_context & Context) -> asio::awaitable<void> {
+	const auto Stop = executor::StopAssetOf(Context);
 	net::tTimer Timer(Context);
 	const auto WatchDog = executor::abort(Timer);
 
-	do {
-		Timer.expires_after(EventPollInterval);
-	} while (co_await net::expired(Timer) and gui::isAlive());
-	executor::StopAssetOf(Context).request_stop();
+	bool Quit = false;
+	gui::watchEvents([&](gui::tEvent Event) {
+		Quit = Quit or Event == gui::tEvent::quit;
+	});
+
+	while (not Quit and not Stop.stop_requested()) {
+		Timer.expires_at(gui::lastPumped() + EventLatency);
+		if (not co_await net::expired(Timer))
+			break;
+		if (gui::lastPumped() + EventLatency <= net::tTimer::clock_type::now())
+			gui::pumpEvents();
+	}
+	gui::watchEvents({});
+	Stop.request_stop();
 }
+#endif
 
 } // namespace handleEvents
@@ -2,6 +2,7 @@ export module executor;
 import std;
 
 import asio;
+import metrics;
 
 // Convenience types and functions to deal with the executor part of the
 // Asio library https://think-async.com/Asio/
@@ -66,7 +67,7 @@ template <typename T>
 asio::execution_context & getContext(T & Object) noexcept {
 	if constexpr (isExecutionContext<T>)
 		return Object;
-	else if constexpr (isExecutor<T>)
+	else if constexpr (isExecutor<std::remove_cv_t<T>>)
 		return Object.context();
 	else if constexpr (hasExecutor<T>)
 		return Object.get_executor().context();
@@ -99,6 +100,80 @@ struct isCallable {
 	static constexpr bool asynchronously   = invocable and returnsAwaitable;
 };
 
+// the label of the piece of work that is currently running on the event loop.
+// nullptr if the loop runs no labelled work or no work at all.
+
+inline std::atomic<const char *> RunningWork = nullptr;
+
+struct RunningAs {
+	RunningAs(const char * Label, metrics::Subsystem Tag) noexcept
+	: Outer_(RunningWork.exchange(Label, std::memory_order_relaxed))
+	, InScope_(Tag) {}
+	~RunningAs() { RunningWork.store(Outer_, std::memory_order_relaxed); }
+	RunningAs(const RunningAs &) = delete;
+
+private:
+	const char * Outer_;
+	metrics::Scope InScope_;
+};
+
+// an executor that runs everything that is submitted to it on its 'Inner' executor,
+// labelled with a name and with a subsystem in charge of allocations. all properties
+// are those of the 'Inner' executor.
+
+template <typename Inner>
+struct Labelled {
+	Inner Inner_;
+	const char * Label_;
+	metrics::Subsystem Tag_;
+
+	template <typename Property>
+	    requires(asio::can_query<const Inner &, const Property &>::value)
+	auto query(const Property & Wanted) const {
+		return asio::query(Inner_, Wanted);
+	}
+	template <typename Property>
+	    requires(asio::can_require<const Inner &, const Property &>::value)
+	auto require(const Property & Wanted) const {
+		return executor::Labelled{ asio::require(Inner_, Wanted), Label_, Tag_ };
+	}
+	template <typename Property>
+	    requires(asio::can_prefer<const Inner &, const Property &>::value)
+	auto prefer(const Property & Wanted) const {
+		return executor::Labelled{ asio::prefer(Inner_, Wanted), Label_, Tag_ };
+	}
+	asio::execution_context & context() const noexcept {
+		return asio::query(Inner_, asio::execution::context);
+	}
+
+	template <typename Func>
+	void execute(Func && Work) const {
+		auto Run = [Label = Label_, Tag = Tag_,
+		            Work_ = std::forward<Func>(Work)]() mutable {
+			const RunningAs Running{ Label, Tag };
+			std::move(Work_)();
+		};
+		Inner_.execute(std::move(Run));
+	}
+	bool operator==(const Labelled &) const noexcept = default;
+};
+
+// return an executor that labels all work that is commissioned to it with the given
+// 'Label', such that stalls of the event loop can be attributed to that work. the
+// allocations of that work are attributed to the given subsystem.
+
+export [[nodiscard]] auto
+labelled(auto & Object, const char * Label,
+         metrics::Subsystem Tag = metrics::Subsystem::executor) {
+	using T = std::remove_cvref_t<decltype(Object)>;
+	if constexpr (isExecutor<T>)
+		return Labelled{ Object, Label, Tag };
+	else if constexpr (hasExecutor<T>)
+		return Labelled{ Object.get_executor(), Label, Tag };
+	else
+		static_assert(Unfortunate<T>, "Please give me an executor");
+}
+
 // initiate independent asynchronous execution of a piece of work on a given executor.
 // signal stop if an exception escapes that piece of work.
 
@@ -135,6 +210,88 @@ export [[nodiscard]] auto makeScheduler(asio::io_context & Context,
 	};
 }
 
+// the watchdog posts heartbeats onto the event loop and measures how late they run.
+// when a heartbeat is late by more than a given threshold, the loop is stalled by the
+// piece of work that happens to be running at that time.
+// the delays of all heartbeats and the stalls per culprit go into histograms.
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+static constexpr auto HeartbeatInterval = 50ms;
+
+struct Watchdog : ServiceBase {
+	using key_type = Watchdog;
+
+	static asio::io_context::id id;
+
+	Watchdog(asio::io_context & Loop, std::chrono::milliseconds Threshold)
+	: ServiceBase(Loop)
+	, Loop_(Loop)
+	, Threshold_(Threshold)
+	, Thread_([this](std::stop_token Stop) { watch(Stop); }) {}
+
+private:
+	void shutdown() noexcept override {
+		Thread_.request_stop();
+		if (Thread_.joinable())
+			Thread_.join();
+	}
+
+	// sleep for the given 'Duration' or until stop is requested, whatever comes first
+	bool sleepFor(std::stop_token & Stop, Clock::duration Duration) {
+		std::unique_lock Lock{ Mutex_ };
+		Wakeup_.wait_for(Lock, Stop, Duration, [] { return false; });
+		return not Stop.stop_requested();
+	}
+
+	void watch(std::stop_token Stop) {
+		using std::chrono::duration_cast, std::chrono::microseconds;
+		const metrics::Scope InScope{ metrics::Subsystem::executor };
+		auto & Delays = metrics::histogram("event loop delay");
+
+		while (sleepFor(Stop, HeartbeatInterval)) {
+			const auto Posted = Clock::now();
+			Beaten_.store(false);
+			asio::post(Loop_, [this, Posted, &Delays] {
+				Delay_ = Clock::now() - Posted;
+				Delays.record(duration_cast<microseconds>(Delay_));
+				Beaten_.store(true);
+			});
+
+			const char * Culprit = nullptr;
+			bool Stalled         = false;
+			while (not Beaten_.load()) {
+				if (not sleepFor(Stop, Threshold_ / 4))
+					return;
+				if (not Stalled and Clock::now() - Posted > Threshold_) {
+					Stalled = true;
+					Culprit = RunningWork.load(std::memory_order_relaxed);
+				}
+			}
+			if (not Stalled)
+				continue;
+			const auto Name = std::format("stalls in {}", Culprit ? Culprit : "unnamed");
+			metrics::histogram(Name).record(duration_cast<microseconds>(Delay_));
+		}
+	}
+
+	asio::io_context & Loop_;
+	const Clock::duration Threshold_;
+	Clock::duration Delay_{};
+	std::atomic_bool Beaten_ = false;
+	std::mutex Mutex_;
+	std::condition_variable_any Wakeup_;
+	std::jthread Thread_;
+};
+
+// watch the given event loop for stalls longer than the given 'Threshold'.
+// the watchdog ends with the event loop.
+
+export void watchForStalls(asio::io_context & Loop, std::chrono::milliseconds Threshold) {
+	asio::make_service<Watchdog>(Loop, Threshold);
+}
+
 // abort operation of a given object depending on its capabilities.
 // the close() operation is customizable to cater for more involved closing requirements.
 
@@ -1,14 +1,41 @@
 ﻿module gui;
+import metrics;
 
 namespace gui {
+static constexpr auto InCharge = metrics::Subsystem::gui;
 
-static const auto initializedSDL    = SDL_Init(SDL_INIT_VIDEO);
 static constexpr auto TextureFormat = SDL_PIXELFORMAT_ARGB8888;
+static constexpr auto BytesPerPixel = 4; // of all formats in use
 
 static constexpr bool successful(int Code) {
 	return Code == 0;
 }
 
+// the last stages of the way of a frame to the screen, their durations are recorded
+// with every frame. the histograms are looked up with the first frame, not at load time.
+
+using Clock = std::chrono::steady_clock;
+
+static metrics::Histogram & converting() {
+	static auto & Stage = metrics::histogram("gui: convert");
+	return Stage;
+}
+
+static metrics::Histogram & presenting() {
+	static auto & Stage = metrics::histogram("gui: present");
+	return Stage;
+}
+
+static void record(metrics::Histogram & Stage, Clock::time_point Start,
+                   Clock::time_point End) noexcept {
+	using std::chrono::duration_cast, std::chrono::microseconds;
+	Stage.record(duration_cast<microseconds>(End - Start));
+}
+
+// the texture of a window is attached to it such that the window can redraw itself
+// from within the event watch
+static constexpr auto TextureOfWindow = "texture";
+
 static auto centeredBox(tDimensions Dimensions,
                         int Monitor = SDL_GetNumVideoDisplays()) noexcept {
 	struct {
@@ -28,7 +55,22 @@ static auto centeredBox(tDimensions Dimensions,
 	return Box;
 }
 
+static int sourceFormatOf(const video::FrameHeader & Header) noexcept {
+	return Header.Format_ == std::to_underlying(video::PixelFormat::RGBA)
+	           ? SDL_PIXELFORMAT_ABGR8888
+	           : SDL_PIXELFORMAT_ARGB8888;
+}
+
+// SDL is initialized with the first window. processes without any window, e.g. a
+// server on its own, never pay for initializing the video subsystem.
+
+static void initializeSDL() noexcept {
+	static const auto Initialized = SDL_Init(SDL_INIT_VIDEO);
+	(void)Initialized;
+}
+
 FancyWindow::FancyWindow(tDimensions Dimensions) noexcept {
+	initializeSDL();
 	const auto Viewport = centeredBox(Dimensions);
 
 	Window_   = { "Look at me!", // clang-format off
@@ -45,46 +87,269 @@ FancyWindow::FancyWindow(tDimensions Dimensions) noexcept {
 void FancyWindow::updateFrom(const video::FrameHeader & Header) noexcept {
 	if (not Header.isFirstFrame())
 		return;
+	const metrics::Scope InScope{ InCharge };
 
+	// the textures stay in the pool when the window goes out of use
 	if (Header.hasNoPixels()) {
 		SDL_HideWindow(Window_);
-		Texture_ = {};
+		SDL_SetWindowData(Window_, TextureOfWindow, nullptr);
+		Active_ = NoTextures;
 	} else {
-		Width_        = Header.Width_;
-		Height_       = Header.Height_;
 		PixelsPitch_  = Header.LinePitch_;
-		SourceFormat_ = Header.Format_ == std::to_underlying(video::PixelFormat::RGBA)
-		                    ? SDL_PIXELFORMAT_ABGR8888
-		                    : SDL_PIXELFORMAT_ARGB8888;
-		Texture_ = sdl::Texture(Renderer_, TextureFormat, SDL_TEXTUREACCESS_STREAMING,
-		                        Width_, Height_);
+		SourceFormat_ = sourceFormatOf(Header);
+		// the textures of the same shape are kept, e.g. when a stream resumes
+		if (Active_ != NoTextures and Width_ == Header.Width_ and
+		    Height_ == Header.Height_)
+			return;
+
+		Width_  = Header.Width_;
+		Height_ = Header.Height_;
+		Active_ = static_cast<unsigned>(&texturesFor(Width_, Height_) - Pool_.data());
+		// nothing is drawn into the textures of the new shape yet
+		SDL_SetWindowData(Window_, TextureOfWindow, nullptr);
 		SDL_SetWindowMinimumSize(Window_, Width_, Height_);
 		SDL_RenderSetLogicalSize(Renderer_, Width_, Height_);
 		SDL_ShowWindow(Window_);
 	}
 }
 
+// the texture set of the given dimensions from the pool. if there is none, it takes the
+// place of the set that was used least recently. switching between videos of common
+// dimensions then creates no textures at all.
+
+tTextureSet & FancyWindow::texturesFor(int Width, int Height) {
+	auto Set = std::ranges::find_if(Pool_, [=](const tTextureSet & Candidate) {
+		return have(Candidate.Textures_[0]) and Candidate.Width_ == Width and
+		       Candidate.Height_ == Height;
+	});
+	if (Set == Pool_.end()) {
+		Set          = std::ranges::min_element(Pool_, {}, &tTextureSet::LastUsed_);
+		Set->Width_  = Width;
+		Set->Height_ = Height;
+		Set->Next_   = 0;
+		for (auto & Texture : Set->Textures_)
+			Texture = sdl::Texture(Renderer_, TextureFormat, SDL_TEXTUREACCESS_STREAMING,
+			                       Width, Height);
+	}
+	Set->LastUsed_ = ++Uses_;
+	return *Set;
+}
+
+// the size of the window contents in pixels
+
+tDimensions FancyWindow::viewport() const noexcept {
+	int Width  = 0;
+	int Height = 0;
+	SDL_GetRendererOutputSize(Renderer_, &Width, &Height);
+	constexpr int Largest = std::numeric_limits<uint16_t>::max();
+	return { static_cast<uint16_t>(std::clamp(Width, 0, Largest)),
+		     static_cast<uint16_t>(std::clamp(Height, 0, Largest)) };
+}
+
+// the frame goes into the texture of the set that was presented least recently. the
+// renderer may still be busy with the texture of the previous frame, filling the other
+// one doesn't have to wait for it.
+
 void FancyWindow::present(video::tPixels Pixels) noexcept {
+	const metrics::Scope InScope{ InCharge };
 	void * TextureData;
 	int TexturePitch;
 
+	const auto Start = Clock::now();
 	SDL_RenderClear(Renderer_);
-	if (successful(SDL_LockTexture(Texture_, nullptr, &TextureData, &TexturePitch))) {
-		SDL_ConvertPixels(Width_, Height_, SourceFormat_, Pixels.data(), PixelsPitch_,
-		                  TextureFormat, TextureData, TexturePitch);
-		SDL_UnlockTexture(Texture_);
-		SDL_RenderCopy(Renderer_, Texture_, nullptr, nullptr);
+	if (Active_ != NoTextures) {
+		auto & Set     = Pool_[Active_];
+		auto & Texture = Set.Textures_[Set.Next_];
+		if (successful(SDL_LockTexture(Texture, nullptr, &TextureData, &TexturePitch))) {
+			SDL_ConvertPixels(Width_, Height_, SourceFormat_, Pixels.data(), PixelsPitch_,
+			                  TextureFormat, TextureData, TexturePitch);
+			SDL_UnlockTexture(Texture);
+			SDL_RenderCopy(Renderer_, Texture, nullptr, nullptr);
+			SDL_SetWindowData(Window_, TextureOfWindow,
+			                  static_cast<SDL_Texture *>(Texture));
+			Set.Next_ = (Set.Next_ + 1) % TexturesInTurn;
+		}
 	}
+	const auto Converted = Clock::now();
 	SDL_RenderPresent(Renderer_);
+	record(converting(), Start, Converted);
+	record(presenting(), Converted, Clock::now());
+	pumpEvents();
+}
+
+// a mosaic presents at the pace of the display on its own. waiting for the vertical
+// retrace would stall the event loop with every present.
+
+Mosaic::Mosaic(tDimensions Dimensions, unsigned Tiles) noexcept
+: Columns_{ static_cast<unsigned>(std::ceil(std::sqrt(std::max(Tiles, 1u)))) }
+, Rows_{ (std::max(Tiles, 1u) + Columns_ - 1) / Columns_ } {
+	initializeSDL();
+	const auto Viewport = centeredBox(Dimensions);
+	Tile_ = { static_cast<uint16_t>(Viewport.Width / Columns_),
+		      static_cast<uint16_t>(Viewport.Height / Rows_) };
+
+	Window_   = { "Look at us!", Viewport.x, Viewport.y,
+		          Viewport.Width, Viewport.Height, SDL_WINDOW_RESIZABLE };
+	Renderer_ = { Window_, -1, SDL_RENDERER_ACCELERATED };
+	Atlas_    = { Renderer_, TextureFormat, SDL_TEXTUREACCESS_STREAMING, Viewport.Width,
+		          Viewport.Height };
+	SDL_SetWindowData(Window_, TextureOfWindow, static_cast<SDL_Texture *>(Atlas_));
+
+	SDL_SetWindowMinimumSize(Window_, Viewport.Width, Viewport.Height);
+	SDL_RenderSetLogicalSize(Renderer_, Viewport.Width, Viewport.Height);
+	SDL_RenderSetIntegerScale(Renderer_, SDL_TRUE);
+	SDL_SetRenderDrawColor(Renderer_, 240, 240, 240, 240);
+	clear({ 0, 0, Viewport.Width, Viewport.Height });
 }
 
-bool isAlive() noexcept {
-	SDL_Event event;
-	while (SDL_PollEvent(&event)) {
-		if (event.type == SDL_QUIT)
-			return false;
+void Mosaic::present() noexcept {
+	const metrics::Scope InScope{ InCharge };
+	if (std::exchange(Changed_, false)) {
+		SDL_RenderClear(Renderer_);
+		SDL_RenderCopy(Renderer_, Atlas_, nullptr, nullptr);
+		SDL_RenderPresent(Renderer_);
 	}
-	return true;
+	pumpEvents();
+}
+
+std::chrono::microseconds Mosaic::refreshInterval() const noexcept {
+	constexpr int DefaultRate = 60; // Hz
+	SDL_DisplayMode Mode;
+	const bool isKnown = successful(SDL_GetWindowDisplayMode(Window_, &Mode)) and
+	                     Mode.refresh_rate > 0;
+	return std::chrono::microseconds{ 1'000'000 / (isKnown ? Mode.refresh_rate
+	                                                       : DefaultRate) };
+}
+
+// only the given area of the atlas is locked, and uploaded when it is unlocked again
+
+void Mosaic::draw(SDL_Rect Area, int Format, const std::byte * Pixels,
+                  int Pitch) noexcept {
+	void * TextureData;
+	int TexturePitch;
+	if (successful(SDL_LockTexture(Atlas_, &Area, &TextureData, &TexturePitch))) {
+		SDL_ConvertPixels(Area.w, Area.h, Format, Pixels, Pitch, TextureFormat,
+		                  TextureData, TexturePitch);
+		SDL_UnlockTexture(Atlas_);
+		Changed_ = true;
+	}
+}
+
+// cleared areas are transparent, they show the background
+
+void Mosaic::clear(SDL_Rect Area) noexcept {
+	void * TextureData;
+	int TexturePitch;
+	if (successful(SDL_LockTexture(Atlas_, &Area, &TextureData, &TexturePitch))) {
+		const auto Bytes     = static_cast<std::byte *>(TextureData);
+		const auto LineBytes = static_cast<std::size_t>(Area.w) * BytesPerPixel;
+		for (auto Line = 0; Line < Area.h; ++Line)
+			std::fill_n(Bytes + Line * TexturePitch, LineBytes, std::byte{ 0 });
+		SDL_UnlockTexture(Atlas_);
+		Changed_ = true;
+	}
+}
+
+Tile::Tile(std::shared_ptr<Mosaic> Mosaic, unsigned Index) noexcept
+: Mosaic_{ std::move(Mosaic) } {
+	const auto [Width, Height] = Mosaic_->Tile_;
+	const auto Column          = static_cast<int>(Index % Mosaic_->Columns_);
+	const auto Row             = static_cast<int>(Index / Mosaic_->Columns_);
+	Area_                      = { Column * Width, Row * Height, Width, Height };
+}
+
+void Tile::updateFrom(const video::FrameHeader & Header) noexcept {
+	if (not Header.isFirstFrame())
+		return;
+	const metrics::Scope InScope{ InCharge };
+
+	// the previous video may have covered more of the tile
+	Mosaic_->clear(Area_);
+	Shown_ = {};
+	if (Header.hasNoPixels())
+		return;
+
+	const auto Width  = std::min<int>(Header.Width_, Area_.w);
+	const auto Height = std::min<int>(Header.Height_, Area_.h);
+	const auto Left   = static_cast<std::size_t>(Header.Width_ - Width) / 2;
+	const auto Top    = static_cast<std::size_t>(Header.Height_ - Height) / 2;
+	Shown_            = { .x = Area_.x + (Area_.w - Width) / 2,
+		                  .y = Area_.y + (Area_.h - Height) / 2,
+		                  .w = Width,
+		                  .h = Height };
+	PixelsPitch_      = Header.LinePitch_;
+	SourceFormat_     = sourceFormatOf(Header);
+	Offset_           = Top * PixelsPitch_ + Left * BytesPerPixel;
+}
+
+void Tile::present(video::tPixels Pixels) noexcept {
+	if (SDL_RectEmpty(&Shown_) or Pixels.size() <= Offset_)
+		return;
+	const metrics::Scope InScope{ InCharge };
+	const auto Start = Clock::now();
+	Mosaic_->draw(Shown_, SourceFormat_, Pixels.data() + Offset_, PixelsPitch_);
+	record(converting(), Start, Clock::now());
+}
+
+tDimensions Tile::viewport() const noexcept {
+	return { static_cast<uint16_t>(Area_.w), static_cast<uint16_t>(Area_.h) };
+}
+
+// show the most recent frame of a window again, e.g. after it was resized or exposed.
+// the contents of a texture persist after it was rendered.
+
+static void redraw(Uint32 WindowID) noexcept {
+	const auto Window   = SDL_GetWindowFromID(WindowID);
+	const auto Renderer = Window ? SDL_GetRenderer(Window) : nullptr;
+	if (Renderer == nullptr)
+		return;
+
+	SDL_RenderClear(Renderer);
+	if (const auto Texture = SDL_GetWindowData(Window, TextureOfWindow))
+		SDL_RenderCopy(Renderer, static_cast<SDL_Texture *>(Texture), nullptr, nullptr);
+	SDL_RenderPresent(Renderer);
+}
+
+// SDL calls the event watch in the very moment when an event is queued. this happens
+// while pumping the events on the thread that owns the windows. on some platforms,
+// this is the only way to see the window events while the spectator resizes a window.
+
+static tEventHandler EventHandler;
+
+static int watch(void *, SDL_Event * Event) {
+	if (Event->type == SDL_QUIT) {
+		if (EventHandler)
+			EventHandler(tEvent::quit);
+	} else if (Event->type == SDL_WINDOWEVENT) {
+		switch (Event->window.event) {
+		case SDL_WINDOWEVENT_EXPOSED:
+		case SDL_WINDOWEVENT_SIZE_CHANGED: redraw(Event->window.windowID); break;
+		default: break;
+		}
+	}
+	return 0;
+}
+
+void watchEvents(tEventHandler Handler) {
+	SDL_DelEventWatch(watch, nullptr);
+	EventHandler = std::move(Handler);
+	if (EventHandler)
+		SDL_AddEventWatch(watch, nullptr);
+}
+
+// all events were seen by the watch already, the queue is of no further interest
+
+static Clock::time_point LastPumped;
+
+void pumpEvents() noexcept {
+	const metrics::Scope InScope{ InCharge };
+	SDL_PumpEvents();
+	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+	LastPumped = Clock::now();
+}
+
+auto lastPumped() noexcept -> Clock::time_point {
+	return LastPumped;
 }
 
 } // namespace gui
@@ -16,6 +16,21 @@ using Renderer = stdex::c_resource<SDL_Renderer, SDL_CreateRenderer, SDL_Destroy
 using Texture  = stdex::c_resource<SDL_Texture, SDL_CreateTexture, SDL_DestroyTexture>;
 } // namespace sdl
 
+namespace gui {
+static constexpr auto PooledDimensions = 4u; // texture sets per window
+static constexpr auto TexturesInTurn   = 2u; // per texture set
+
+// streaming textures of the same dimensions that take turns in receiving frames. a
+// frame is converted into one of them while the renderer may still consume another.
+struct tTextureSet {
+	std::array<sdl::Texture, TexturesInTurn> Textures_;
+	int Width_              = 0;
+	int Height_             = 0;
+	unsigned Next_          = 0;
+	std::uint64_t LastUsed_ = 0;
+};
+} // namespace gui
+
 export namespace gui {
 struct tDimensions {
 	uint16_t Width;
@@ -30,17 +45,83 @@ struct FancyWindow {
 
 	void updateFrom(const video::FrameHeader & Header) noexcept;
 	void present(video::tPixels Pixels) noexcept;
+	[[nodiscard]] tDimensions viewport() const noexcept;
 
 private:
+	tTextureSet & texturesFor(int Width, int Height);
+
+	static constexpr auto NoTextures = PooledDimensions;
+
 	sdl::Window Window_;
 	sdl::Renderer Renderer_;
-	sdl::Texture Texture_;
+	std::array<tTextureSet, PooledDimensions> Pool_;
+	unsigned Active_    = NoTextures;
+	std::uint64_t Uses_ = 0;
 	int Width_;
 	int Height_;
 	int PixelsPitch_;
 	int SourceFormat_;
 };
 
-bool isAlive() noexcept;
+// a single window that shows many videos at once, each one in a tile of its own. all
+// tiles are drawn into one texture, the atlas, and the window presents them together,
+// once per display refresh at most.
+// the tiles are arranged in a grid that is about as wide as it is high.
+struct Tile;
+struct Mosaic {
+	Mosaic(tDimensions, unsigned Tiles) noexcept;
+
+	// show all tiles that changed since the last time
+	void present() noexcept;
+	[[nodiscard]] std::chrono::microseconds refreshInterval() const noexcept;
+
+private:
+	friend Tile;
+	void draw(SDL_Rect Area, int Format, const std::byte * Pixels, int Pitch) noexcept;
+	void clear(SDL_Rect Area) noexcept;
+
+	sdl::Window Window_;
+	sdl::Renderer Renderer_;
+	sdl::Texture Atlas_;
+	unsigned Columns_;
+	unsigned Rows_;
+	tDimensions Tile_;
+	bool Changed_ = false;
+};
+
+// a tile of a mosaic takes the place of a window. videos are centered in their tile,
+// larger ones are cropped.
+struct Tile {
+	Tile(std::shared_ptr<Mosaic> Mosaic, unsigned Index) noexcept;
+
+	void updateFrom(const video::FrameHeader & Header) noexcept;
+	void present(video::tPixels Pixels) noexcept;
+	[[nodiscard]] tDimensions viewport() const noexcept;
+
+private:
+	std::shared_ptr<Mosaic> Mosaic_;
+	SDL_Rect Area_;
+	SDL_Rect Shown_{};
+	std::size_t Offset_ = 0; // of the shown pixels within the frame
+	int PixelsPitch_    = 0;
+	int SourceFormat_   = 0;
+};
+
+// the events that the application learns about. windows take care of being resized
+// or exposed on their own.
+enum class tEvent { quit };
+using tEventHandler = std::function<void(tEvent)>;
+
+// have the given 'Handler' called right when the GUI sees an event. an empty handler
+// ends watching.
+void watchEvents(tEventHandler Handler);
+
+// make the windows receive and react to their pending events.
+// presenting a frame does that, too. there is no need to pump events in between frames
+// other than to keep windows responsive while no frames arrive.
+void pumpEvents() noexcept;
+
+// the point in time when the events were pumped the last time
+[[nodiscard]] auto lastPumped() noexcept -> std::chrono::steady_clock::time_point;
 
 } // namespace gui
@@ -0,0 +1,143 @@
+export module inprocess;
+import std;
+
+import asio;
+import net;
+import video;
+import protocol;
+
+// an in-process transport that hands frames over from the server to the client
+// without going through the network stack.
+//
+// servers register the endpoints that they are listening at. clients that try to
+// connect to one of those endpoints from within the same process are connected through
+// a channel instead of a socket. frames are passed by reference-counted ownership of
+// their pixels, there is no copy involved.
+
+namespace aex = asio::experimental;
+namespace inprocess {
+
+static constexpr auto ChannelCapacity = 1u;
+
+export {
+	using tChannel = net::use_await::as_default_on_t<
+	    aex::channel<void(std::error_code, video::Frame)>>;
+
+	// one end of an in-process connection, supporting the same operations that are
+	// required from a socket
+
+	struct tConnection {
+		[[nodiscard]] bool is_open() const noexcept {
+			return Channel_ and Channel_->is_open();
+		}
+		[[nodiscard]] auto get_executor() const { return Channel_->get_executor(); }
+
+		std::shared_ptr<tChannel> Channel_;
+		std::optional<protocol::Hello> Hello_; // the greeting of the connecting client
+	};
+	using tExpectConnection = net::tExpected<tConnection>;
+	using tAcceptHandler    = std::function<void(tConnection)>;
+} // export
+
+using ServiceBase = asio::execution_context::service;
+
+// the registry of all endpoints that are served by this process.
+
+struct Registry : ServiceBase {
+	using key_type = Registry;
+
+	static asio::io_context::id id;
+
+	using ServiceBase::ServiceBase;
+
+	void add(const net::tEndpoint & Endpoint, tAcceptHandler Handler) {
+		Acceptors_.insert_or_assign(Endpoint, std::move(Handler));
+	}
+	void remove(const net::tEndpoint & Endpoint) noexcept { Acceptors_.erase(Endpoint); }
+
+	// an unspecified address (e.g. 0.0.0.0 or ::) listens at all local addresses
+	auto find(const net::tEndpoint & Endpoint) const -> const tAcceptHandler * {
+		for (const auto & [Listening, Handler] : Acceptors_) {
+			if (Listening == Endpoint or
+			    (Listening.port() == Endpoint.port() and
+			     Listening.protocol() == Endpoint.protocol() and
+			     Listening.address().is_unspecified()))
+				return &Handler;
+		}
+		return nullptr;
+	}
+
+private:
+	void shutdown() noexcept override { Acceptors_.clear(); }
+	std::map<net::tEndpoint, tAcceptHandler> Acceptors_;
+};
+
+export {
+	// accept in-process connections at the given 'Endpoint' as long as the returned
+	// object is alive.
+
+	[[nodiscard]] auto listen(asio::execution_context & Context, net::tEndpoint Endpoint,
+	                          tAcceptHandler Handler) {
+		auto & Acceptors = asio::use_service<Registry>(Context);
+		Acceptors.add(Endpoint, std::move(Handler));
+
+		struct Listening {
+			Listening(Registry & Acceptors, net::tEndpoint Endpoint) noexcept
+			: Acceptors_(Acceptors)
+			, Endpoint_(std::move(Endpoint)) {}
+			Listening(const Listening &)             = delete;
+			Listening & operator=(const Listening &) = delete;
+			~Listening() { Acceptors_.remove(Endpoint_); }
+
+		private:
+			Registry & Acceptors_;
+			net::tEndpoint Endpoint_;
+		};
+		return Listening{ Acceptors, std::move(Endpoint) };
+	}
+
+	// connect to the first one of the given 'Endpoints' that is served by this process.
+	// the 'Hello' of the client is handed to the server right away.
+
+	[[nodiscard]] auto connectTo(asio::io_context & Context, net::tEndpoints Endpoints,
+	                             const protocol::Hello & Hello) -> tExpectConnection {
+		const auto & Acceptors = asio::use_service<Registry>(Context);
+		for (const auto & Endpoint : Endpoints) {
+			if (const auto * Accept = Acceptors.find(Endpoint)) {
+				auto Channel = std::make_shared<tChannel>(Context, ChannelCapacity);
+				(*Accept)(tConnection{ Channel, Hello });
+				return tConnection{ std::move(Channel) };
+			}
+		}
+		return std::unexpected{ std::make_error_code(std::errc::connection_refused) };
+	}
+
+	void close(tConnection & Connection) noexcept {
+		if (Connection.Channel_)
+			Connection.Channel_->close();
+	}
+
+	// the same contracts as the socket-based operations in module 'net'
+
+	auto sendTo(tConnection & Connection, net::tTimer & Timer, video::Frame Frame)
+	    -> asio::awaitable<net::tExpectSize> {
+		Frame           = video::makeShared(std::move(Frame));
+		const auto Size = Frame.TotalSize();
+
+		const auto Sent = co_await (
+		    Connection.Channel_->async_send(std::error_code{}, std::move(Frame)) ||
+		    Timer.async_wait());
+		if (Sent.index() != 0)
+			co_return std::unexpected{ std::make_error_code(std::errc::timed_out) };
+		if (const auto & [Error] = std::get<0>(Sent); Error)
+			co_return std::unexpected{ Error };
+		co_return Size;
+	}
+
+	auto receiveFrom(tConnection & Connection, net::tTimer & Timer)
+	    -> asio::awaitable<net::tExpected<video::Frame>> {
+		co_return net::flatten(
+		    co_await (Connection.Channel_->async_receive() || Timer.async_wait()));
+	}
+} // export
+} // namespace inprocess
@@ -14,6 +14,7 @@ The client
  - tries to connect to anyone of a list of given server endpoints
  - receives video frames from the network connection
  - presents the video frames in a reasonable manner in a GUI window
+ - or presents many streams at once in the tiles of a single window
 
 The application
 
@@ -26,41 +27,124 @@ import std;
 
 import asio;
 import executor;
-import gui;
+import metrics;
 import net;
 import the.whole.caboodle;
+import video;
 
-import client;
 import events;
 import server;
+#if not defined(DEMO_SERVER_ONLY)
+import client;
+import gui;
+#endif
 
 using namespace std::chrono_literals;
 
 static constexpr auto ServerPort        = net::tPort{ 34567 };
 static constexpr auto ResolveTimeBudget = 1s;
+#if not defined(DEMO_SERVER_ONLY)
+static constexpr auto WindowSize        = gui::tDimensions{ 1280, 1024 };
+#endif
+
+#if not defined(DEMO_SERVER_ONLY)
+// the tiles of a mosaic take turns in streaming from the given servers. names that
+// can't be resolved are passed over, the server at 'Fallback' takes their place if
+// none is left.
+
+[[nodiscard]] auto resolveMosaicSources(std::vector<std::string> Servers,
+                                        std::vector<net::tEndpoint> Fallback)
+    -> asio::awaitable<std::vector<std::vector<net::tEndpoint>>> {
+	std::vector<std::vector<net::tEndpoint>> Sources;
+	for (const auto & Server : Servers) {
+		auto Endpoints =
+		    co_await net::resolveHostEndpoints(Server, ServerPort, ResolveTimeBudget);
+		if (Endpoints.empty())
+			std::println("mosaic server {} is unknown", Server);
+		else
+			Sources.push_back(std::move(Endpoints));
+	}
+	if (Sources.empty())
+		Sources.push_back(std::move(Fallback));
+	co_return Sources;
+}
+#endif
+
+// resolve the server endpoints on the running execution context, then bring up the
+// server and the client, depending on the roles that were asked for.
+// a replay needs neither, it ends with the last frame.
+// the exit code tells the reason for an early end.
+// a server-only build knows no other role than the server.
+
+[[nodiscard]] auto startUp(asio::io_context & Context, caboodle::tOptions Options,
+                           int & ExitCode) -> asio::awaitable<void> {
+#if not defined(DEMO_SERVER_ONLY)
+	if (not Options.Replay.empty()) {
+		co_await client::replayVideos(Context, gui::FancyWindow(WindowSize),
+		                              Options.Replay, Options.atMaxSpeed);
+		executor::StopAssetOf(Context).request_stop();
+		co_return;
+	}
+#endif
+	const auto ServerEndpoints = co_await net::resolveHostEndpoints(
+	    Options.Server, ServerPort, ResolveTimeBudget);
+	const server::tLimits Limits{ .Clients            = Options.MaxClients,
+		                          .ClientsPerEndpoint = Options.MaxEndpointClients,
+		                          .EgressBytes = std::size_t{ Options.MaxEgress } << 20 };
+	const video::tReading Reading{ .BlockSize = std::size_t{ Options.ReadBlock } << 10,
+		                           .Prefetch  = std::size_t{ Options.ReadAhead } << 10,
+		                           .Lookahead = Options.Lookahead };
+	using enum caboodle::tRole;
+	if (ServerEndpoints.empty()) {
+		ExitCode = -3;
+	} else if (has(Options.Role, server) and
+	           not server::serve(Context, ServerEndpoints, std::move(Options.Media),
+	                             Limits, Reading)) {
+		ExitCode = -4;
+	} else {
+		if (not has(Options.Role, client))
+			co_return;
+#if not defined(DEMO_SERVER_ONLY)
+		if (Options.Mosaic > 0)
+			co_await client::showMosaic(
+			    Context, WindowSize, Options.Mosaic,
+			    co_await resolveMosaicSources(std::move(Options.MosaicServers),
+			                                  ServerEndpoints));
+		else
+			co_await client::showVideos(Context, gui::FancyWindow(WindowSize),
+			                            ServerEndpoints, Options.Capture);
+#endif
+		co_return;
+	}
+	executor::StopAssetOf(Context).request_stop();
+}
 
 int main(int argc, char * argv[]) {
-	auto [MediaDirectory, ServerName] = caboodle::getOptions(argc, argv);
-	if (MediaDirectory.empty())
+	auto Options = caboodle::getOptions(argc, argv);
+	if (Options.Media.empty())
 		return -2;
-	const auto ServerEndpoints =
-	    net::resolveHostEndpoints(ServerName, ServerPort, ResolveTimeBudget);
-	if (ServerEndpoints.empty())
-		return -3;
 
 	asio::io_context ExecutionContext; // we have executors at home
 	std::stop_source Stop;             // the mother of all stops
 	const auto schedule = executor::makeScheduler(ExecutionContext, Stop);
+	if (Options.StallThreshold > 0)
+		executor::watchForStalls(ExecutionContext,
+		                         std::chrono::milliseconds{ Options.StallThreshold });
 
-	const auto Listening =
-	    schedule(server::serve, ServerEndpoints, std::move(MediaDirectory));
-	if (not Listening)
-		return -4;
-
-	schedule(client::showVideos, gui::FancyWindow({ .Width = 1280, .Height = 1024 }),
-	         ServerEndpoints);
+	// a server on its own never brings up the GUI
+	const bool withGUI =
+	    has(Options.Role, caboodle::tRole::client) or not Options.Replay.empty();
+	int ExitCode       = 0;
+	schedule(startUp, std::move(Options), ExitCode);
 	schedule(handleEvents::fromTerminal);
-	schedule(handleEvents::fromGUI);
+#if not defined(DEMO_SERVER_ONLY)
+	if (withGUI)
+		schedule(handleEvents::fromGUI);
+#else
+	(void)withGUI; // there is no GUI to bring up
+#endif
 
 	ExecutionContext.run();
+	metrics::report();
+	return ExitCode;
 }
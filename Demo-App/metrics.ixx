@@ -0,0 +1,184 @@
+export module metrics;
+import std;
+
+// a minimal metrics layer: named histograms of durations that are recorded while the
+// application runs, from any thread, and reported when it ends.
+
+namespace metrics {
+using std::chrono::microseconds;
+
+export struct Histogram {
+	// bucket 'b' counts durations of less than 2^b µs, the last one takes all the rest
+	static constexpr auto Buckets = 24u;
+
+	void record(microseconds Duration) noexcept {
+		const auto Ticks  = Duration.count();
+		const auto Value  = Ticks > 0 ? static_cast<std::uint64_t>(Ticks) : 0u;
+		const auto Bucket = std::min<std::size_t>(std::bit_width(Value), Buckets - 1);
+		Counts_[Bucket].fetch_add(1, std::memory_order_relaxed);
+		Total_.fetch_add(Value, std::memory_order_relaxed);
+		for (auto Max = Max_.load(std::memory_order_relaxed);
+		     Value > Max and not Max_.compare_exchange_weak(Max, Value);) {
+		}
+	}
+
+	[[nodiscard]] auto count() const noexcept -> std::uint64_t {
+		std::uint64_t Count = 0;
+		for (const auto & Bucket : Counts_)
+			Count += Bucket.load(std::memory_order_relaxed);
+		return Count;
+	}
+
+	// the upper bound of the bucket that holds the given 'Percentile'
+	[[nodiscard]] auto percentile(unsigned Percentile) const noexcept -> microseconds {
+		const auto Wanted = (count() * Percentile + 99) / 100;
+		std::uint64_t Count = 0;
+		for (auto Bucket = 0u; Bucket < Buckets; ++Bucket) {
+			Count += Counts_[Bucket].load(std::memory_order_relaxed);
+			if (Count >= Wanted)
+				return microseconds{ 1ll << Bucket };
+		}
+		return max();
+	}
+
+	[[nodiscard]] auto mean() const noexcept -> microseconds {
+		const auto Count = count();
+		return microseconds{ Count > 0 ? Total_.load() / Count : 0 };
+	}
+	[[nodiscard]] auto max() const noexcept -> microseconds {
+		return microseconds{ Max_.load() };
+	}
+
+private:
+	std::array<std::atomic<std::uint64_t>, Buckets> Counts_{};
+	std::atomic<std::uint64_t> Total_ = 0;
+	std::atomic<std::uint64_t> Max_   = 0;
+};
+
+// the subsystems that heap allocations are attributed to. the subsystem in charge is
+// a property of each thread, it is set for the extent of a scope.
+
+export enum class Subsystem : unsigned char { other, executor, net, decoder, gui };
+constexpr std::string_view SubsystemNames[] = { "other", "executor", "net", "decoder",
+	                                            "gui" };
+constexpr auto Subsystems = std::size(SubsystemNames);
+
+export inline thread_local Subsystem InCharge = Subsystem::other;
+
+export struct Scope {
+	explicit Scope(Subsystem Tag) noexcept
+	: Outer_{ std::exchange(InCharge, Tag) } {}
+	~Scope() { InCharge = Outer_; }
+	Scope(const Scope &) = delete;
+
+private:
+	Subsystem Outer_;
+};
+
+// run 'Work' with the given subsystem in charge
+export decltype(auto) tagged(Subsystem Tag, auto && Work) {
+	const Scope InScope{ Tag };
+	return Work();
+}
+
+// the heap usage per subsystem. it is tracked only in builds that hook into the global
+// allocation functions, see 'allocationtracking.cpp'. the bookkeeping must not allocate.
+
+struct HeapUsage {
+	std::atomic<std::uint64_t> Allocations_ = 0;
+	std::atomic<std::uint64_t> Bytes_       = 0;
+	std::atomic<std::int64_t> Live_         = 0;
+	std::atomic<std::int64_t> Peak_         = 0;
+
+	void grow(std::int64_t Size) noexcept {
+		const auto Live = Live_.fetch_add(Size, std::memory_order_relaxed) + Size;
+		for (auto Peak = Peak_.load(std::memory_order_relaxed);
+		     Live > Peak and not Peak_.compare_exchange_weak(Peak, Live);) {
+		}
+	}
+};
+
+HeapUsage Heap[Subsystems];
+HeapUsage Total;
+
+export void allocated(Subsystem Tag, std::size_t Size) noexcept {
+	for (auto * Usage : { &Heap[std::to_underlying(Tag)], &Total }) {
+		Usage->Allocations_.fetch_add(1, std::memory_order_relaxed);
+		Usage->Bytes_.fetch_add(Size, std::memory_order_relaxed);
+		Usage->grow(static_cast<std::int64_t>(Size));
+	}
+}
+
+export void released(Subsystem Tag, std::size_t Size) noexcept {
+	const auto Released = static_cast<std::int64_t>(Size);
+	for (auto * Usage : { &Heap[std::to_underlying(Tag)], &Total })
+		Usage->Live_.fetch_sub(Released, std::memory_order_relaxed);
+}
+
+// the heap usage is reported relative to the number of frames that the application has
+// handled. a frame that is sent to a client in the same process is presented on screen
+// as well, therefore both ways are counted apart. the presented frames take precedence.
+
+export enum class Passage : unsigned char { sent, presented };
+std::atomic<std::uint64_t> Frames[2] = {};
+
+export void countFrame(Passage Way, std::uint64_t Count = 1) noexcept {
+	Frames[std::to_underlying(Way)].fetch_add(Count, std::memory_order_relaxed);
+}
+
+void reportHeapUsage() {
+	const auto Allocations = Total.Allocations_.load();
+	if (Allocations == 0)
+		return;
+	const auto Presented = Frames[std::to_underlying(Passage::presented)].load();
+	const auto Handled =
+	    Presented > 0 ? Presented : Frames[std::to_underlying(Passage::sent)].load();
+	const auto PerFrame = std::max<std::uint64_t>(Handled, 1);
+	std::println("heap usage over {} {} frames, peak {} live bytes:", Handled,
+	             Presented > 0 ? "presented" : "sent", Total.Peak_.load());
+	for (auto Tag = 0u; Tag < Subsystems; ++Tag) {
+		const auto & Usage = Heap[Tag];
+		if (const auto Count = Usage.Allocations_.load(); Count > 0)
+			std::println("  {:8} {:10.1f} allocations, {:12.0f} bytes per frame, peak {} "
+			             "live bytes",
+			             SubsystemNames[Tag], double(Count) / PerFrame,
+			             double(Usage.Bytes_.load()) / PerFrame, Usage.Peak_.load());
+	}
+}
+
+struct Registry {
+	std::mutex Mutex_;
+	std::map<std::string, Histogram, std::less<>> Histograms_;
+};
+
+Registry & registry() {
+	static Registry Instance;
+	return Instance;
+}
+
+// the histogram of the given 'Name', it is created on first use.
+// histograms live until the end of the program.
+
+export auto histogram(std::string_view Name) -> Histogram & {
+	auto & [Mutex, Histograms] = registry();
+	std::scoped_lock Lock{ Mutex };
+	if (const auto Known = Histograms.find(Name); Known != Histograms.end())
+		return Known->second;
+	return Histograms.try_emplace(std::string{ Name }).first->second;
+}
+
+// print a summary of all histograms that have recorded anything, and of the heap usage
+// if it was tracked.
+
+export void report() {
+	reportHeapUsage();
+	auto & [Mutex, Histograms] = registry();
+	std::scoped_lock Lock{ Mutex };
+	for (const auto & [Name, Histogram] : Histograms) {
+		if (const auto Count = Histogram.count(); Count > 0)
+			std::println("{}: {} times, mean {}, p50 < {}, p99 < {}, max {}", Name, Count,
+			             Histogram.mean(), Histogram.percentile(50),
+			             Histogram.percentile(99), Histogram.max());
+	}
+}
+} // namespace metrics
@@ -0,0 +1,94 @@
+module;
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#	error this is not POSIX!
+#endif
+
+module net;
+import std;
+import asio;
+
+namespace net {
+
+#if defined(TCP_CORK)
+static constexpr int CorkOption = TCP_CORK; // Linux
+#elif defined(TCP_NOPUSH)
+static constexpr int CorkOption = TCP_NOPUSH; // BSDs and macOS
+#endif
+
+void cork(tSocket & Socket, bool Corked) noexcept {
+#if defined(TCP_CORK) or defined(TCP_NOPUSH)
+	const int Value = Corked;
+	::setsockopt(Socket.native_handle(), IPPROTO_TCP, CorkOption, &Value, sizeof(Value));
+#else
+	(void)Socket;
+	(void)Corked;
+#endif
+}
+
+// Linux paces sockets with SO_MAX_PACING_RATE, in bytes per second. the option is 32
+// bits wide on all kernels, all ones mean 'unlimited'.
+
+bool setPacingRate(tSocket & Socket, std::uint64_t BytesPerSecond) noexcept {
+#if defined(SO_MAX_PACING_RATE)
+	constexpr std::uint64_t Unlimited = ~0u;
+	const auto Limited = std::min(BytesPerSecond, Unlimited - 1);
+	const auto Rate    = static_cast<unsigned>(BytesPerSecond == 0 ? Unlimited : Limited);
+	return ::setsockopt(Socket.native_handle(), SOL_SOCKET, SO_MAX_PACING_RATE, &Rate,
+	                    sizeof(Rate)) == 0;
+#else
+	(void)Socket;
+	(void)BytesPerSecond;
+	return false;
+#endif
+}
+
+// the runtime directory of the user is private. without one, the user gets a directory
+// of its own within the temp directory. either one is taken only if it belongs to the
+// user and nobody else has access.
+
+static bool isPrivate(const char * Path) noexcept {
+	struct stat Status;
+	return ::lstat(Path, &Status) == 0 and S_ISDIR(Status.st_mode) and
+	       Status.st_uid == ::geteuid() and (Status.st_mode & 077) == 0;
+}
+
+auto privateDirectory() -> tExpected<std::filesystem::path> {
+	const char * Runtime = std::getenv("XDG_RUNTIME_DIR");
+	if (Runtime != nullptr and isPrivate(Runtime))
+		return std::filesystem::path{ Runtime };
+
+	std::error_code Error;
+	auto Directory = std::filesystem::temp_directory_path(Error);
+	if (Error)
+		return std::unexpected{ Error };
+	Directory /= std::format("CppInAction-{}", ::geteuid());
+	if (::mkdir(Directory.c_str(), 0700) != 0 and errno != EEXIST)
+		return std::unexpected{ std::error_code{ errno, std::system_category() } };
+	if (not isPrivate(Directory.c_str()))
+		return std::unexpected{ std::make_error_code(std::errc::permission_denied) };
+	return Directory;
+}
+
+bool isOwnUser(tLocalSocket & Socket) noexcept {
+#if defined(SO_PEERCRED)
+	ucred Peer;
+	socklen_t Size = sizeof(Peer);
+	if (::getsockopt(Socket.native_handle(), SOL_SOCKET, SO_PEERCRED, &Peer, &Size) != 0)
+		return false;
+	return Peer.uid == ::geteuid();
+#else
+	uid_t User;
+	gid_t Group;
+	if (::getpeereid(Socket.native_handle(), &User, &Group) != 0)
+		return false;
+	return User == ::geteuid();
+#endif
+}
+} // namespace net
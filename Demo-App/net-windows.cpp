@@ -0,0 +1,32 @@
+module;
+
+#ifndef _WIN32
+#	error this is not Windows!
+#endif
+
+module net;
+import std;
+
+// Windows has no way to cork a TCP socket. all frames of a batch are handed over in a
+// single scatter-gather write anyway, and Nagle's algorithm is turned off.
+// nor can it pace a single socket, the token bucket takes care of that.
+// the temp directory is private to each user already. same-host connections go through
+// tcp, their peers are never trusted.
+
+namespace net {
+
+void cork(tSocket &, bool) noexcept {}
+bool setPacingRate(tSocket &, std::uint64_t) noexcept {
+	return false;
+}
+auto privateDirectory() -> tExpected<std::filesystem::path> {
+	std::error_code Error;
+	auto Directory = std::filesystem::temp_directory_path(Error);
+	if (Error)
+		return std::unexpected{ Error };
+	return Directory;
+}
+bool isOwnUser(tLocalSocket &) noexcept {
+	return false;
+}
+} // namespace net
@@ -13,19 +13,194 @@ auto sendTo(tSocket & Socket, tTimer & Timer, tConstBuffers Data)
     -> awaitable<tExpectSize> {
 	co_return flatten(co_await (async_write(Socket, Data) || Timer.async_wait()));
 }
+auto sendTo(tLocalSocket & Socket, tTimer & Timer, tConstBuffers Data)
+    -> awaitable<tExpectSize> {
+	co_return flatten(co_await (async_write(Socket, Data) || Timer.async_wait()));
+}
+
+static constexpr std::size_t PacingQuantum = 16u << 10; // bytes
+
+static void consume(std::vector<const_buffer> & Buffers, std::size_t Bytes) noexcept {
+	auto Buffer = Buffers.begin();
+	for (; Buffer != Buffers.end() and Bytes >= Buffer->size(); ++Buffer)
+		Bytes -= Buffer->size();
+	if (Buffer != Buffers.end())
+		*Buffer += Bytes;
+	Buffers.erase(Buffers.begin(), Buffer);
+}
+
+// without help from the kernel, paced data goes out in chunks of a limited size. each
+// chunk takes as many tokens from the bucket as it has bytes, the tokens refill at the
+// pacing rate. a full bucket holds the tokens for a single chunk.
+// precondition: not Data.empty()
+
+auto sendTo(tSocket & Socket, tTimer & Timer, tConstBuffers Data, tPacer & Pacer)
+    -> awaitable<tExpectSize> {
+	if (Pacer.Rate_ == 0 or Pacer.byKernel_)
+		co_return co_await sendTo(Socket, Timer, Data);
+
+	using Clock   = std::chrono::steady_clock;
+	using Seconds = std::chrono::duration<double>;
+	const auto Rate = static_cast<double>(Pacer.Rate_);
+	std::vector<const_buffer> Remaining(Data.begin(), Data.end());
+	tTimer Refill(Socket.get_executor());
+	std::size_t Sent = 0;
+
+	for (auto Left = buffer_size(Data); Left > 0;) {
+		const auto Now      = Clock::now();
+		const auto Refilled = Seconds{ Now - Pacer.Refilled_ }.count() * Rate;
+		Pacer.Tokens_   = std::min(Pacer.Tokens_ + Refilled, double{ PacingQuantum });
+		Pacer.Refilled_ = Now;
+
+		const auto Chunk = std::min(Left, PacingQuantum);
+		if (Pacer.Tokens_ < static_cast<double>(Chunk)) {
+			const Seconds Lacking{ (static_cast<double>(Chunk) - Pacer.Tokens_) / Rate };
+			Refill.expires_after(std::chrono::ceil<Clock::duration>(Lacking));
+			if ((co_await (Refill.async_wait() || Timer.async_wait())).index() != 0)
+				co_return std::unexpected{ std::make_error_code(std::errc::timed_out) };
+			continue;
+		}
+		const auto Written =
+		    flatten(co_await (async_write(Socket, Remaining, transfer_exactly(Chunk)) ||
+		                      Timer.async_wait()));
+		if (not Written)
+			co_return Written;
+		Pacer.Tokens_ -= static_cast<double>(*Written);
+		consume(Remaining, *Written);
+		Sent += *Written;
+		Left -= *Written;
+	}
+	co_return Sent;
+}
+
+// small changes of the rate aren't worth a system call
+void pace(tSocket & Socket, tPacer & Pacer, std::uint64_t Rate) noexcept {
+	const auto Change = Rate > Pacer.Rate_ ? Rate - Pacer.Rate_ : Pacer.Rate_ - Rate;
+	if (Change == 0 or (Rate > 0 and Pacer.Rate_ > 0 and Change < Pacer.Rate_ / 8))
+		return;
+	Pacer.Rate_     = Rate;
+	Pacer.byKernel_ = setPacingRate(Socket, Rate);
+}
 
 // precondition: not Space.empty()
 auto receiveFrom(tSocket & Socket, tTimer & Timer, tByteSpan Space)
     -> awaitable<tExpectSize> {
 	co_return flatten(co_await (async_read(Socket, buffer(Space)) || Timer.async_wait()));
 }
+auto receiveFrom(tLocalSocket & Socket, tTimer & Timer, tByteSpan Space)
+    -> awaitable<tExpectSize> {
+	co_return flatten(co_await (async_read(Socket, buffer(Space)) || Timer.async_wait()));
+}
+
+// receive whatever is available, but at least one byte
+// precondition: not Space.empty()
+auto receiveSome(tSocket & Socket, tTimer & Timer, tByteSpan Space)
+    -> awaitable<tExpectSize> {
+	co_return flatten(
+	    co_await (Socket.async_read_some(buffer(Space)) || Timer.async_wait()));
+}
+
+// connect to anyone of a list of endpoints, the "happy eyeballs" way (RFC 8305):
+//  - interleave the address families, starting with the preferred one
+//  - start another connection attempt whenever the previous one fails, or takes
+//    longer than a short delay
+//  - the first successful attempt wins, all others are cancelled
+
+using namespace std::chrono_literals;
+static constexpr auto ConnectionAttemptDelay = 250ms;
+
+static auto interleaveFamilies(tEndpoints Endpoints) -> std::vector<tEndpoint> {
+	std::vector<tEndpoint> Preferred;
+	std::vector<tEndpoint> Others;
+	for (const auto & Endpoint : Endpoints) {
+		const bool isPreferred = Endpoint.protocol() == Endpoints.front().protocol();
+		(isPreferred ? Preferred : Others).push_back(Endpoint);
+	}
+
+	std::vector<tEndpoint> Interleaved;
+	Interleaved.reserve(Endpoints.size());
+	for (std::size_t Index = 0; Index < std::max(Preferred.size(), Others.size());
+	     ++Index) {
+		if (Index < Preferred.size())
+			Interleaved.push_back(Preferred[Index]);
+		if (Index < Others.size())
+			Interleaved.push_back(Others[Index]);
+	}
+	return Interleaved;
+}
+
+struct ConnectionRace {
+	ConnectionRace(const tTimer::executor_type & Executor, std::size_t Contenders)
+	: Wakeup_(Executor) {
+		Sockets_.reserve(Contenders); // keep the sockets in place
+	}
+
+	std::vector<tSocket> Sockets_;
+	std::optional<std::size_t> Winner_;
+	std::size_t Running_   = 0;
+	std::error_code Error_ = std::make_error_code(std::errc::host_unreachable);
+	tTimer Wakeup_;
+};
+
+static auto attempt(std::shared_ptr<ConnectionRace> Race, std::size_t Contender,
+                    tEndpoint Endpoint) -> awaitable<void> {
+	const auto [Error] = co_await Race->Sockets_[Contender].async_connect(Endpoint);
+	--Race->Running_;
+	if (Error)
+		Race->Error_ = Error;
+	else if (not Race->Winner_)
+		Race->Winner_ = Contender;
+	Race->Wakeup_.cancel();
+}
+
+// returns false if the overall time budget is exhausted
+static auto progressOf(ConnectionRace & Race, tTimer & Timer) -> awaitable<bool> {
+	const auto Progress = co_await (Race.Wakeup_.async_wait() || Timer.async_wait());
+	co_return Progress.index() == 0;
+}
 
 // precondition: not Endpoints.empty()
 auto connectTo(tEndpoints Endpoints, tTimer & Timer) -> awaitable<tExpectSocket> {
-	tSocket Socket(Timer.get_executor());
-	co_return replace(
-	    flatten(co_await (async_connect(Socket, Endpoints) || Timer.async_wait())),
-	    std::move(Socket));
+	const auto Executor = Timer.get_executor();
+	const auto Race     = std::make_shared<ConnectionRace>(Executor, Endpoints.size());
+
+	bool inTime = true;
+	for (const auto & Endpoint : interleaveFamilies(Endpoints)) {
+		const auto Contender = Race->Sockets_.size();
+		Race->Sockets_.emplace_back(Executor);
+		++Race->Running_;
+		co_spawn(Executor, attempt(Race, Contender, Endpoint), detached);
+
+		Race->Wakeup_.expires_after(ConnectionAttemptDelay);
+		inTime = co_await progressOf(*Race, Timer);
+		if (Race->Winner_ or not inTime)
+			break;
+	}
+	while (inTime and not Race->Winner_ and Race->Running_ > 0) {
+		Race->Wakeup_.expires_at(tTimer::time_point::max());
+		inTime = co_await progressOf(*Race, Timer);
+	}
+
+	for (std::size_t Contender = 0; Contender < Race->Sockets_.size(); ++Contender) {
+		if (Contender != Race->Winner_)
+			close(Race->Sockets_[Contender]);
+	}
+	if (Race->Winner_)
+		co_return std::move(Race->Sockets_[*Race->Winner_]);
+	if (not inTime)
+		co_return std::unexpected{ std::make_error_code(std::errc::timed_out) };
+	co_return std::unexpected{ Race->Error_ };
+}
+
+auto connectTo(tLocalEndpoint Endpoint, tTimer & Timer) -> awaitable<tExpectLocalSocket> {
+	tLocalSocket Socket(Timer.get_executor());
+	const auto Connected =
+	    co_await (Socket.async_connect(Endpoint) || Timer.async_wait());
+	if (Connected.index() != 0)
+		co_return std::unexpected{ std::make_error_code(std::errc::timed_out) };
+	if (const auto [Error] = std::get<0>(Connected); Error)
+		co_return std::unexpected{ Error };
+	co_return std::move(Socket);
 }
 
 auto expired(tTimer & Timer) noexcept -> asio::awaitable<bool> {
@@ -38,33 +213,77 @@ void close(tSocket & Socket) noexcept {
 	Socket.shutdown(tSocket::shutdown_both, Error);
 	Socket.close(Error);
 }
+void close(tLocalSocket & Socket) noexcept {
+	std::error_code Error;
+	Socket.shutdown(tLocalSocket::shutdown_both, Error);
+	Socket.close(Error);
+}
 
 using namespace std::string_view_literals;
 static constexpr auto Local = "localhost"sv;
 
+// resolve on the execution context of the caller, within the given time budget
 // precondition: TimeBudget > 0
 auto resolveHostEndpoints(std::string_view HostName, tPort Port,
                           std::chrono::milliseconds TimeBudget)
-    -> std::vector<tEndpoint> {
-	using tResolver = asio::ip::tcp::resolver;
+    -> awaitable<std::vector<tEndpoint>> {
+	using tResolver = use_await::as_default_on_t<asio::ip::tcp::resolver>;
 	auto Flags      = tResolver::numeric_service;
 	if (HostName.empty() || HostName == Local) {
 		Flags    |= tResolver::passive;
 		HostName = Local;
 	}
 
+	const auto Executor = co_await this_coro::executor;
+	const auto Service  = std::to_string(Port);
+	tResolver Resolver(Executor);
+	tTimer Timer(Executor);
+	Timer.expires_after(TimeBudget);
+
 	std::vector<tEndpoint> Endpoints;
-	const auto toEndpoints = [&](const auto &, auto Resolved) {
-		Endpoints.reserve(Resolved.size());
-		for (const auto & Element : Resolved)
+	const auto Resolved =
+	    flatten(co_await (Resolver.async_resolve(HostName, Service, Flags) ||
+	                      Timer.async_wait()));
+	if (Resolved) {
+		Endpoints.reserve(Resolved->size());
+		for (const auto & Element : *Resolved)
 			Endpoints.push_back(Element.endpoint());
-	};
+	}
+	co_return Endpoints;
+}
 
-	asio::io_context Executor;
-	tResolver Resolver(Executor);
-	Resolver.async_resolve(HostName, std::to_string(Port), Flags, toEndpoints);
-	Executor.run_for(TimeBudget);
-	return Endpoints;
+// the rendezvous points live in a private directory such that no other user can take
+// over the place of a server.
+
+auto localEndpoint(tPort Port) -> tExpected<tLocalEndpoint> {
+	const auto Name = std::format("CppInAction-{}.socket", std::to_underlying(Port));
+	return privateDirectory().transform([&](const std::filesystem::path & Directory) {
+		return tLocalEndpoint{ (Directory / Name).string() };
+	});
+}
+
+// a rendezvous point is stale if a connection attempt is refused. a server that is
+// still running is left alone.
+
+bool clearRendezvous(io_context & Context, const tLocalEndpoint & Endpoint) {
+	namespace fs = std::filesystem;
+	const fs::path Path = Endpoint.path();
+	std::error_code Error;
+	if (not fs::exists(fs::symlink_status(Path, Error)))
+		return true;
+
+	tLocal::socket Probe(Context);
+	Probe.connect(Endpoint, Error);
+	if (not Error)
+		return false;
+	if (Error == std::errc::connection_refused)
+		fs::remove(Path, Error);
+	return not fs::exists(fs::symlink_status(Path, Error));
+}
+
+bool isOnThisHost(const tEndpoint & Endpoint) noexcept {
+	const auto Address = Endpoint.address();
+	return Address.is_loopback() or Address.is_unspecified();
 }
 
 } // namespace net
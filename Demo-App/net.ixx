@@ -31,6 +31,13 @@ export {
 
 	using tEndpoint      = asio::ip::tcp::endpoint;
 	using tEndpoints     = std::span<const tEndpoint>;
+
+	// same-host connections through AF_UNIX sockets
+	using tLocal         = asio::local::stream_protocol;
+	using tLocalSocket   = use_await::as_default_on_t<tLocal::socket>;
+	using tLocalAcceptor = use_await::as_default_on_t<tLocal::acceptor>;
+	using tLocalEndpoint = tLocal::endpoint;
+
 	using tByteSpan      = std::span<std::byte>;
 	using tConstByteSpan = std::span<const std::byte>;
 
@@ -44,10 +51,27 @@ export {
 
 	template <typename T>
 	using tExpected     = std::expected<T, std::error_code>;
-	using tExpectSize   = tExpected<std::size_t>;
-	using tExpectSocket = tExpected<tSocket>;
+	using tExpectSize        = tExpected<std::size_t>;
+	using tExpectSocket      = tExpected<tSocket>;
+	using tExpectLocalSocket = tExpected<tLocalSocket>;
+
+	// the egress of a socket is paced at a rate of bytes per second, zero means
+	// 'unpaced'. the kernel paces the socket where it can, otherwise the data goes out in
+	// chunks as a token bucket permits.
+	struct tPacer {
+		std::uint64_t Rate_ = 0;
+		bool byKernel_      = false;
+		double Tokens_      = 0; // bytes
+		std::chrono::steady_clock::time_point Refilled_;
+	};
 } // export
 
+// have the kernel pace the egress of a socket, if it can. zero means 'unpaced'.
+bool setPacingRate(tSocket & Socket, std::uint64_t BytesPerSecond) noexcept;
+
+// a directory that no one but the current user can access
+auto privateDirectory() -> tExpected<std::filesystem::path>;
+
 // transform the 'variant' return type from asio operator|| into an 'expected'
 // as simply as possible to scare away no one. No TMP required here!
 
@@ -90,15 +114,41 @@ export {
 
 	auto sendTo(tSocket & Socket, tTimer & Timer, tConstBuffers DataToSend)
 	    ->asio::awaitable<tExpectSize>;
+	auto sendTo(tSocket & Socket, tTimer & Timer, tConstBuffers DataToSend,
+	            tPacer & Pacer)
+	    ->asio::awaitable<tExpectSize>;
 	auto receiveFrom(tSocket & Socket, tTimer & Timer, tByteSpan SpaceToFill)
 	    ->asio::awaitable<tExpectSize>;
+	auto receiveSome(tSocket & Socket, tTimer & Timer, tByteSpan SpaceToFill)
+	    ->asio::awaitable<tExpectSize>;
+	auto sendTo(tLocalSocket & Socket, tTimer & Timer, tConstBuffers DataToSend)
+	    ->asio::awaitable<tExpectSize>;
+	auto receiveFrom(tLocalSocket & Socket, tTimer & Timer, tByteSpan SpaceToFill)
+	    ->asio::awaitable<tExpectSize>;
 	auto connectTo(tEndpoints EndpointsToTry, tTimer & Timer)
 	    ->asio::awaitable<tExpectSocket>;
+	auto connectTo(tLocalEndpoint Endpoint, tTimer & Timer)
+	    ->asio::awaitable<tExpectLocalSocket>;
 	auto expired(tTimer & Timer) noexcept -> asio::awaitable<bool>;
 
 	void close(tSocket & Socket) noexcept;
+	void close(tLocalSocket & Socket) noexcept;
+	// hold back partial segments while corked, send them when uncorked
+	void cork(tSocket & Socket, bool Corked) noexcept;
+	// pace the egress of the socket at the given rate from now on
+	void pace(tSocket & Socket, tPacer & Pacer, std::uint64_t BytesPerSecond) noexcept;
 	auto resolveHostEndpoints(std::string_view HostName, tPort Port,
 	                          std::chrono::milliseconds TimeBudget)
-	    ->std::vector<tEndpoint>;
+	    ->asio::awaitable<std::vector<tEndpoint>>;
+
+	// the AF_UNIX rendezvous point of servers of the current user that listen at 'Port'
+	// on this host
+	auto localEndpoint(tPort Port) -> tExpected<tLocalEndpoint>;
+	// remove a leftover rendezvous point from an earlier run. returns false if someone
+	// still accepts connections there.
+	bool clearRendezvous(asio::io_context & Context, const tLocalEndpoint & Endpoint);
+	// the peer at the other end runs as the current user
+	bool isOwnUser(tLocalSocket & Socket) noexcept;
+	bool isOnThisHost(const tEndpoint & Endpoint) noexcept;
 } // export
 } // namespace net
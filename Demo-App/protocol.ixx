@@ -0,0 +1,212 @@
+export module protocol;
+import std;
+
+import video;
+
+// the messages that a client and the server exchange besides the frames.
+
+export namespace protocol {
+
+// version 1 of the protocol sends compact frame headers, version 2 full-width ones.
+constexpr inline std::uint16_t Version = 2;
+
+// the optional features of the protocol that are negotiated when a connection starts.
+
+enum Feature : std::uint16_t {
+	Resume       = 1 << 0, // continue a session where it was interrupted
+	ContentCache = 1 << 1, // omit the pixels of frames that the client holds already
+	Downscale    = 1 << 2, // fit frames into the client's viewport
+	Batching     = 1 << 3, // many frames per network write
+	LatencyProbe = 1 << 4, // frames carry the server's times, clients probe its clock
+	FormatRGBA   = 1 << 8, // the pixel formats that the client can present
+	FormatBGRA   = 1 << 9,
+};
+using tFeatures = std::uint16_t;
+
+constexpr Feature formatFeature(video::PixelFormat Format) noexcept {
+	using enum video::PixelFormat;
+	return Format == RGBA ? FormatRGBA : Format == BGRA ? FormatBGRA : Feature{};
+}
+
+// messages go over the wire as they are. they have the size that the other side
+// expects, and they are trivially copyable to guarantee relocatability.
+
+template <typename T>
+concept Message = std::is_trivially_copyable_v<T> and sizeof(T) == T::SizeBytes;
+
+static constexpr std::uint32_t Greeting = 0x4849'4331;
+
+// the client greets the server right after connecting. it offers the highest protocol
+// version and all features that it supports.
+// it identifies itself by a session number that stays the same across reconnects, and
+// tells the server the last frame that it has presented, and the media file that the
+// frame came from. a server that remembers the session resumes playback right after
+// that frame.
+// network clients also tell how many KiB of pixels they are willing to cache.
+// all clients tell the size of their viewport, frames are scaled down to fit into it.
+// clients talk only to servers that answer the greeting with a welcome. servers that
+// don't know about greetings are out of reach of these clients.
+
+struct Hello {
+	static constexpr auto SizeBytes = 40u;
+
+	using µSeconds = video::FrameHeader::µSeconds;
+
+	std::uint32_t Magic_   = Greeting;
+	std::uint16_t Version_ = protocol::Version;
+	tFeatures Features_    = 0;
+	std::uint32_t Session_ = 0;
+	std::int32_t Sequence_ = 0;
+	µSeconds Timestamp_{ 0 };
+	std::uint32_t CacheBudget_   = 0;
+	std::int32_t ViewportWidth_  = 0; // no limits if zero
+	std::int32_t ViewportHeight_ = 0;
+	std::uint32_t Media_         = 0; // the tag of the media of the last frame
+
+	constexpr bool isValid() const noexcept {
+		return Magic_ == Greeting and Version_ > 0;
+	}
+	constexpr bool wantsResume() const noexcept { return Sequence_ > 0; }
+
+	// remember the frame that was presented last, only frames with visible content
+	// are worth resuming from.
+	constexpr void presented(const video::FrameHeader & Header) noexcept {
+		Sequence_  = Header.isFiller() ? 0 : Header.Sequence_;
+		Timestamp_ = Header.isFiller() ? µSeconds{ 0 } : Header.Timestamp_;
+		Media_     = Header.isFiller() ? 0 : Header.Media_;
+	}
+};
+static_assert(Message<Hello>);
+
+// the server answers the greeting with the protocol version and the features that it
+// agrees upon. frames follow right after that.
+
+struct Welcome {
+	static constexpr auto SizeBytes = 8u;
+
+	std::uint32_t Magic_   = Greeting;
+	std::uint16_t Version_ = 1;
+	tFeatures Features_    = 0;
+
+	constexpr bool isValid() const noexcept {
+		return Magic_ == Greeting and Version_ > 0;
+	}
+	constexpr bool has(Feature Wanted) const noexcept { return Features_ & Wanted; }
+	constexpr bool hasCompactHeaders() const noexcept { return Version_ < 2; }
+};
+static_assert(Message<Welcome>);
+
+// agree upon the lowest common version and the features supported by both sides.
+
+constexpr Welcome agreeOn(const Hello & Offer, tFeatures Supported) noexcept {
+	return { .Version_  = std::min(Offer.Version_, protocol::Version),
+		     .Features_ = static_cast<tFeatures>(Offer.Features_ & Supported) };
+}
+
+// on connections to clients with a cache, each frame header is followed by a tag with
+// the hash of the pixels. the pixels are omitted if the client holds them already.
+
+struct ContentTag {
+	static constexpr auto SizeBytes = 16u;
+
+	enum Payload : std::uint32_t { Attached, Cached };
+
+	std::uint64_t Hash_     = 0;
+	Payload Pixels_         = Attached;
+	std::uint32_t Reserved_ = 0;
+};
+static_assert(Message<ContentTag>);
+
+// times on the steady clock of either side, in µs since the epoch of that clock. the
+// epochs differ, the offset between the clocks is estimated from probes.
+
+using tClockTime = std::chrono::duration<std::int64_t, std::micro>;
+
+inline tClockTime clockTime(std::chrono::steady_clock::time_point Time) noexcept {
+	return std::chrono::duration_cast<tClockTime>(Time.time_since_epoch());
+}
+
+static constexpr std::uint32_t Probing = 0x5052'4F42;
+
+// on network connections with latency probes, clients probe the clock of the server
+// every now and then. the probes are the only messages from a client after its
+// greeting.
+
+struct ClockProbe {
+	static constexpr auto SizeBytes = 16u;
+
+	std::uint32_t Magic_    = Probing;
+	std::uint32_t Reserved_ = 0;
+	tClockTime Sent_{ 0 }; // on the client's clock
+
+	constexpr bool isValid() const noexcept { return Magic_ == Probing; }
+};
+static_assert(Message<ClockProbe>);
+
+// on those connections, each frame is followed by a trailer with the times when the
+// server has decoded and sent it. the trailer also answers the most recent clock probe
+// of the client: when the client sent it, and when it arrived at the server. a client
+// estimates the clock offset the NTP way from such an answer and the time when the
+// frame arrived.
+
+struct FrameTrailer {
+	static constexpr auto SizeBytes = 32u;
+
+	tClockTime Decoded_{ 0 };
+	tClockTime Sent_{ 0 };
+	tClockTime Probed_{ 0 };   // on the client's clock, zero if there was no probe yet
+	tClockTime Received_{ 0 }; // on the server's clock
+};
+static_assert(Message<FrameTrailer>);
+
+// the bookkeeping of a content-addressed cache. the sizes of all entries add up to no
+// more than a given budget, the least recently used entries are evicted first.
+// the server keeps a mirror of each client's cache without any 'Payload'. both sides
+// must come to the same decisions, therefore they share this implementation.
+
+template <typename Payload>
+struct ContentCache {
+	explicit ContentCache(std::size_t Budget) noexcept
+	: Budget_{ Budget } {}
+
+	[[nodiscard]] bool isEnabled() const noexcept { return Budget_ > 0; }
+
+	// empty entries or entries that exceed the budget all by themselves are not taken
+	[[nodiscard]] bool accepts(std::uint64_t Hash, std::size_t Size) const noexcept {
+		return Hash != 0 and Size > 0 and Size <= Budget_ and not Index_.contains(Hash);
+	}
+
+	// look up an entry and make it the most recently used one
+	[[nodiscard]] auto find(std::uint64_t Hash) -> Payload * {
+		const auto Found = Index_.find(Hash);
+		if (Found == Index_.end())
+			return nullptr;
+		Entries_.splice(Entries_.begin(), Entries_, Found->second);
+		return &Found->second->Payload_;
+	}
+
+	auto insert(std::uint64_t Hash, std::size_t Size, Payload Content) -> Payload * {
+		if (not accepts(Hash, Size))
+			return nullptr;
+		for (; Used_ + Size > Budget_; Entries_.pop_back()) {
+			Used_ -= Entries_.back().Size_;
+			Index_.erase(Entries_.back().Hash_);
+		}
+		Entries_.push_front({ Hash, Size, std::move(Content) });
+		Index_.emplace(Hash, Entries_.begin());
+		Used_ += Size;
+		return &Entries_.front().Payload_;
+	}
+
+private:
+	struct Entry {
+		std::uint64_t Hash_;
+		std::size_t Size_;
+		Payload Payload_;
+	};
+	std::list<Entry> Entries_;
+	std::unordered_map<std::uint64_t, typename std::list<Entry>::iterator> Index_;
+	std::size_t Budget_;
+	std::size_t Used_ = 0;
+};
+} // namespace protocol
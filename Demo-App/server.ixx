@@ -2,85 +2,896 @@ export module server;
 import std;
 
 import asio;
+import asyncgenerator;
 import net;
 import video;
 import executor;
+import inprocess;
+import metrics;
+import sharedmemory;
+import protocol;
 
 using namespace std::chrono_literals;
-namespace fs = std::filesystem;
+namespace fs  = std::filesystem;
+namespace rgs = std::ranges;
 
 namespace server {
-static constexpr auto SendTimeBudget = 100ms;
+static constexpr auto SendTimeBudget  = 100ms;
+static constexpr auto HelloTimeBudget = 200ms;
+static constexpr auto MaxSessions     = 256u;
+static constexpr auto RecentMedia     = 8u; // per session
+static constexpr auto AdaptedBudget   = 64u << 20; // bytes
+static constexpr auto MaxBatchFrames  = 16u;
+static constexpr auto MaxBatchBytes   = 256u << 10;
+static constexpr auto ProbePeriod     = 100ms;
+static constexpr auto LagToDegrade    = 10ms; // of the event loop
+static constexpr auto LagToRefuse     = 40ms;
+static constexpr auto ReportPeriod    = 1s;
+static constexpr auto DegradedWidth   = 320;
+static constexpr auto DegradedHeight  = 240;
+static constexpr auto MaxViewport     = 1 << 15; // pixels in either direction
+static constexpr auto MaxDecoders     = 8u; // threads
+static constexpr auto DecodeAhead     = 2u; // frames
+static constexpr auto PacedShare      = 0.8; // of the interval between frames
+static constexpr auto MaxPacedSpread  = SendTimeBudget / 2;
 
-// create a closure with a call operator that returns an awaitable taylored to each
+using µSeconds    = video::FrameHeader::µSeconds;
+static constexpr auto Networking = metrics::Subsystem::net;
+using ServiceBase = asio::execution_context::service;
+using CacheMirror = protocol::ContentCache<std::monostate>;
+using Clock       = std::chrono::steady_clock;
+
+// the limits of the load that the server takes on. zero means 'unlimited'.
+
+export struct tLimits {
+	unsigned Clients            = 64; // in total
+	unsigned ClientsPerEndpoint = 64; // as many as a mosaic may have in total
+	std::size_t EgressBytes     = 0; // per second
+};
+
+// the features that this server supports
+static constexpr protocol::tFeatures Supported =
+    protocol::Resume | protocol::ContentCache | protocol::Downscale |
+    protocol::Batching | protocol::FormatRGBA | protocol::FormatBGRA |
+    protocol::LatencyProbe;
+
+// the latencies of frames are probed on network connections only
+template <typename Connection>
+static constexpr protocol::tFeatures SupportedOn =
+    std::is_same_v<Connection, net::tSocket> ? Supported
+                                             : Supported & ~protocol::LatencyProbe;
+
+// the playhead of a session also remembers the media files that it moved into lately.
+// the stream runs ahead of the client, the frame that the client has presented last may
+// well be from one of the earlier files.
+
+struct SessionPlayhead : video::Playhead {
+	void moveInto(fs::path Media) {
+		Recent_.push_back(Media);
+		if (Recent_.size() > RecentMedia)
+			Recent_.pop_front();
+		Media_ = std::move(Media);
+	}
+
+	// the media file with the given 'Tag', if it was played lately
+	[[nodiscard]] auto played(std::uint32_t Tag) const -> const fs::path * {
+		for (auto Media = Recent_.rbegin(); Media != Recent_.rend(); ++Media) {
+			if (video::mediaTag(*Media) == Tag)
+				return &*Media;
+		}
+		return nullptr;
+	}
+
+private:
+	std::deque<fs::path> Recent_;
+};
+
+// the playheads of the client sessions that were served by this process, such that
+// clients can resume playback after reconnecting. the oldest sessions are forgotten
+// first.
+
+struct Sessions : ServiceBase {
+	using key_type = Sessions;
+
+	static asio::io_context::id id;
+
+	using ServiceBase::ServiceBase;
+
+	auto join(std::uint32_t Session) -> std::shared_ptr<SessionPlayhead> {
+		auto & Position = Playheads_[Session];
+		if (not Position) {
+			Position = std::make_shared<SessionPlayhead>();
+			Joined_.push_back(Session);
+			if (Joined_.size() > MaxSessions) {
+				Playheads_.erase(Joined_.front());
+				Joined_.pop_front();
+			}
+		}
+		return Position;
+	}
+
+private:
+	void shutdown() noexcept override {
+		Playheads_.clear();
+		Joined_.clear();
+	}
+	std::unordered_map<std::uint32_t, std::shared_ptr<SessionPlayhead>> Playheads_;
+	std::deque<std::uint32_t> Joined_;
+};
+
+// what the frames of a stream are adapted to: the bounds of the client's viewport, zero
+// means 'unbounded', and the pixel formats that the client can present.
+
+struct Fitting {
+	int MaxWidth_                = 0;
+	int MaxHeight_               = 0;
+	protocol::tFeatures Formats_ = 0;
+	bool isHashed_               = false; // the client caches pixels by their hash
+
+	// frames in a format that the client can't present are converted to one that it can
+	[[nodiscard]] auto formatOf(const video::FrameHeader & Header) const noexcept
+	    -> video::PixelFormat {
+		using enum video::PixelFormat;
+		const auto canPresent = [this](video::PixelFormat Format) {
+			return (Formats_ & protocol::formatFeature(Format)) != 0;
+		};
+		const auto Format = static_cast<video::PixelFormat>(Header.Format_);
+		if (Format == invalid or canPresent(Format))
+			return Format;
+		for (const auto Other : { RGBA, BGRA }) {
+			if (canPresent(Other))
+				return Other;
+		}
+		return Format;
+	}
+};
+
+// the frames of all streams are decoded on a pool of threads, a few frames ahead of
+// their stream. there, they are also adapted to the client of the stream. adapted
+// frames are shared with all clients that want the same size and pixel format.
+// the event loop is never blocked by decoding, scaling, or converting.
+// the playhead of a stream moves only when the stream takes a frame. the decoder works
+// on a playhead of its own and tells when it moves into another media file.
+
+struct DecodedFrame {
+	video::Frame Frame_;
+	std::optional<fs::path> Playing_; // the playhead has moved into this file
+	protocol::tClockTime Decoded_ = protocol::clockTime(Clock::now());
+};
+using DecodedFrames = executor::async_generator<DecodedFrame>;
+
+struct Decoding : ServiceBase {
+	using key_type = Decoding;
+
+	static asio::io_context::id id;
+
+	explicit Decoding(asio::execution_context & Context)
+	: ServiceBase{ Context } {}
+
+	void readWith(const video::tReading & Reading) noexcept { Reading_ = Reading; }
+
+	auto decode(fs::path Source, video::Playhead ResumeAt, Fitting Target)
+	    -> DecodedFrames {
+		return { Pool_.get_executor(), DecodeAhead, generate, this, std::move(Source),
+			     std::move(ResumeAt), Target };
+	}
+
+private:
+	static auto generate(DecodedFrames::sink Out, Decoding * Self, fs::path Source,
+	                     video::Playhead ResumeAt, Fitting Target)
+	    -> asio::awaitable<void> {
+		using enum metrics::Subsystem;
+		const auto Position = std::make_shared<video::Playhead>(std::move(ResumeAt));
+		auto Playing        = Position->Media_;
+		auto Frames         = video::makeFrames(std::move(Source), Position,
+		                                        Self->Reading_);
+		auto Frame          = metrics::tagged(decoder, [&] { return Frames.begin(); });
+		for (; Frame != Frames.end(); metrics::tagged(decoder, [&] { ++Frame; })) {
+			// the frame outlives the generator step
+			DecodedFrame Decoded{ Self->adapt(video::makeShared(*Frame), Target) };
+			auto & Adapted = Decoded.Frame_;
+			if (Target.isHashed_ and Adapted.Hash_ == 0 and not Adapted.Pixels_.empty())
+				Adapted.Hash_ = video::contentHash(Adapted.Pixels_);
+			if (Position->Media_ != Playing)
+				Decoded.Playing_ = Playing = Position->Media_;
+			if (not co_await Out.yield(std::move(Decoded)))
+				co_return;
+		}
+	}
+
+	// scale a frame down to fit into the bounds of the 'Target', and convert it to a
+	// pixel format that the client can present. adapted frames are keyed by the hash
+	// of their source, it is computed here if the decoder didn't yet.
+	auto adapt(const video::Frame & Frame, const Fitting & Target) -> video::Frame {
+		if (Frame.Pixels_.empty())
+			return Frame;
+		const auto & Header = Frame.Header_;
+		const auto [Width, Height] =
+		    video::fittingSize(Header, Target.MaxWidth_, Target.MaxHeight_);
+		const auto Format      = Target.formatOf(Header);
+		const bool isResized   = Width != Header.Width_ or Height != Header.Height_;
+		const bool isConverted = std::to_underlying(Format) != Header.Format_;
+		if (not isResized and not isConverted)
+			return Frame;
+
+		const auto Shape = std::uint64_t(Width) << 32 | std::uint64_t(Height) << 8 |
+		                   std::to_underlying(Format);
+		const auto Hash =
+		    Frame.Hash_ != 0 ? Frame.Hash_ : video::contentHash(Frame.Pixels_);
+		const auto Key = Hash ^ std::rotl(Shape, 24);
+		if (Hash != 0) {
+			std::scoped_lock Lock{ Mutex_ };
+			if (const auto * Adapted = Cache_.find(Key)) {
+				// the same pixels may show up at different times
+				auto Restamped               = *Adapted;
+				Restamped.Header_.Sequence_  = Header.Sequence_;
+				Restamped.Header_.Timestamp_ = Header.Timestamp_;
+				Restamped.Header_.Media_     = Header.Media_;
+				return Restamped;
+			}
+		}
+		auto Fresh = isResized ? video::scaledTo(Frame, Width, Height) : Frame;
+		if (isConverted)
+			Fresh = video::convertedTo(Fresh, Format);
+		if (Hash != 0) {
+			std::scoped_lock Lock{ Mutex_ };
+			Cache_.insert(Key, Fresh.Pixels_.size(), Fresh);
+		}
+		return Fresh;
+	}
+
+	void shutdown() noexcept override {
+		Pool_.stop();
+		Pool_.join();
+		Cache_ = Cache{ 0 };
+	}
+
+	using Cache = protocol::ContentCache<video::Frame>;
+	asio::thread_pool Pool_{ std::clamp(std::thread::hardware_concurrency(), 1u,
+		                                MaxDecoders) };
+	std::mutex Mutex_;
+	Cache Cache_{ AdaptedBudget };
+	video::tReading Reading_;
+};
+
+// a rate that fades away exponentially, such that it reflects about the last second.
+
+struct FadingRate {
+	void add(double Amount, Clock::time_point Now) noexcept {
+		fade(Now);
+		Sum_ += Amount;
+	}
+	[[nodiscard]] double perSecond(Clock::time_point Now) noexcept {
+		fade(Now);
+		return Sum_;
+	}
+
+private:
+	void fade(Clock::time_point Now) noexcept {
+		const std::chrono::duration<double> Elapsed = Now - Last_;
+		Sum_ *= std::exp(-Elapsed.count());
+		Last_ = Now;
+	}
+	double Sum_            = 0.0;
+	Clock::time_point Last_ = Clock::now();
+};
+
+// a pass to be served. it occupies a seat in the server as a whole, and a seat at the
+// endpoint where the client came in, until it expires.
+
+struct Pass {
+	using tSeats = std::shared_ptr<unsigned>;
+
+	Pass(tSeats Server, tSeats Endpoint, bool Degraded) noexcept
+	: Degraded_{ Degraded }
+	, Server_{ std::move(Server) }
+	, Endpoint_{ std::move(Endpoint) } {
+		++*Server_;
+		++*Endpoint_;
+	}
+	Pass(Pass &&) noexcept = default;
+	Pass & operator=(Pass &&) = delete;
+	~Pass() {
+		if (Server_)
+			--*Server_;
+		if (Endpoint_)
+			--*Endpoint_;
+	}
+
+	bool Degraded_;
+
+private:
+	tSeats Server_;
+	tSeats Endpoint_;
+};
+
+// the admission control of new clients. it keeps track of the occupied seats, of the
+// bytes that go out, and of how late the event loop wakes up from timers. the latter
+// is a measure of the CPU load because all connections share a single thread.
+// new clients are refused or get a degraded stream when the server runs out of seats
+// or budget, such that the clients that are served already keep their pacing.
+
+struct Admission : ServiceBase {
+	using key_type = Admission;
+
+	static asio::io_context::id id;
+
+	explicit Admission(asio::execution_context & Context)
+	: ServiceBase{ Context } {}
+
+	void limitTo(const tLimits & Limits) noexcept { Limits_ = Limits; }
+
+	[[nodiscard]] auto admit(const Pass::tSeats & Endpoint) -> std::optional<Pass> {
+		const auto Now     = Clock::now();
+		const auto Verdict = judge(*Endpoint, Now);
+		if (Verdict != Admit)
+			shed(Verdict, Now);
+		if (Verdict == Refuse)
+			return std::nullopt;
+		return Pass{ Server_, Endpoint, Verdict == Degrade };
+	}
+
+	void sent(std::size_t Bytes) noexcept {
+		Egress_.add(static_cast<double>(Bytes), Clock::now());
+	}
+	void lagging(Clock::duration Lag) noexcept { Lag_ = (Lag_ + Lag) / 2; }
+
+private:
+	enum Verdict { Admit, Degrade, Refuse };
+
+	Verdict judge(unsigned EndpointSeats, Clock::time_point Now) noexcept {
+		const auto isFull = [](unsigned Seats, unsigned Limit) {
+			return Limit > 0 and Seats >= Limit;
+		};
+		if (isFull(*Server_, Limits_.Clients) or
+		    isFull(EndpointSeats, Limits_.ClientsPerEndpoint))
+			return Refuse;
+
+		const auto Budget = static_cast<double>(Limits_.EgressBytes);
+		const auto Egress = Budget > 0 ? Egress_.perSecond(Now) / Budget : 0.0;
+		if (Lag_ >= LagToRefuse or Egress >= 1.0)
+			return Refuse;
+		if (Lag_ >= LagToDegrade or Egress >= 0.75)
+			return Degrade;
+		return Admit;
+	}
+
+	void shed(Verdict Kind, Clock::time_point Now) {
+		++(Kind == Refuse ? Refused_ : Degraded_);
+		if (Now - Reported_ < ReportPeriod)
+			return;
+		Reported_ = Now;
+		std::println("load shedding: {} clients refused, {} degraded so far", Refused_,
+		             Degraded_);
+	}
+
+	void shutdown() noexcept override {}
+
+	tLimits Limits_;
+	Pass::tSeats Server_ = std::make_shared<unsigned>(0);
+	FadingRate Egress_;
+	Clock::duration Lag_ = {};
+	Clock::time_point Reported_;
+	std::size_t Refused_  = 0;
+	std::size_t Degraded_ = 0;
+};
+
+// probe the event loop for its lag, i.e. how late it wakes up from a timer.
+
+[[nodiscard]] auto probeLoad(asio::io_context & Context) -> asio::awaitable<void> {
+	net::tTimer Timer(Context);
+	const auto WatchDog = executor::abort(Timer);
+	auto & Load         = asio::use_service<Admission>(Context);
+
+	for (;;) {
+		const auto Due = Clock::now() + ProbePeriod;
+		Timer.expires_at(Due);
+		if (const auto [Error] = co_await Timer.async_wait(); Error)
+			break;
+		Load.lagging(Clock::now() - Due);
+	}
+}
+
+// clients greet the server right after connecting. clients that don't are served from
+// the start.
+
+auto receiveHello(auto & Socket, net::tTimer & Timer)
+    -> asio::awaitable<std::optional<protocol::Hello>> {
+	protocol::Hello Hello;
+	const auto Bytes = std::as_writable_bytes(std::span{ &Hello, 1 });
+	if (co_await net::receiveFrom(Socket, Timer, Bytes) == Bytes.size() and
+	    Hello.isValid())
+		co_return Hello;
+	co_return std::nullopt;
+}
+
+auto receiveHello(shm::tConnection & Connection, net::tTimer & Timer)
+    -> asio::awaitable<std::optional<protocol::Hello>> {
+	co_return co_await receiveHello(Connection.Socket_, Timer);
+}
+
+auto receiveHello(inprocess::tConnection & Connection, net::tTimer &)
+    -> asio::awaitable<std::optional<protocol::Hello>> {
+	co_return Connection.Hello_;
+}
+
+// the server answers a greeting with the terms of the connection.
+
+auto sendWelcome(auto & Socket, net::tTimer & Timer, const protocol::Welcome & Terms)
+    -> asio::awaitable<bool> {
+	net::tSendBuffers<1> Buffers{ net::asBytes(Terms) };
+	const auto Sent = co_await net::sendTo(Socket, Timer, Buffers);
+	co_return Sent == protocol::Welcome::SizeBytes;
+}
+
+auto sendWelcome(shm::tConnection & Connection, net::tTimer & Timer,
+                 const protocol::Welcome & Terms) -> asio::awaitable<bool> {
+	co_return co_await sendWelcome(Connection.Socket_, Timer, Terms);
+}
+
+auto sendWelcome(inprocess::tConnection &, net::tTimer &, const protocol::Welcome &)
+    -> asio::awaitable<bool> {
+	co_return true;
+}
+
+// the egress of network connections is paced such that each frame is spread across
+// the interval since its predecessor, i.e. about the time until its successor is due.
+// connections whose frame boundaries line up don't send synchronized bursts then,
+// these would overflow the buffers of the switches along the way.
+// the frames go out within a share of the interval, and within the send time budget.
+
+struct EgressPace {
+	// the rate in bytes per second that spreads the 'Bytes' actually written for frames
+	// up to the one with the given 'Header', zero means 'unpaced'. cached frames carry
+	// no pixels, they count with their header and tag only.
+	[[nodiscard]] auto rateOf(std::size_t Bytes, const video::FrameHeader & Header)
+	    noexcept -> std::uint64_t {
+		using std::chrono::duration, std::chrono::duration_cast;
+		if (Header.isFiller())
+			return Pacer_.Rate_;
+
+		// the timestamps start over with each video, the pace stays as it is then
+		const auto Previous = std::exchange(Last_, Header.Timestamp_);
+		if (Header.Timestamp_ <= Previous)
+			return Pacer_.Rate_;
+		const auto Interval = Header.Timestamp_ - Previous;
+		const auto Spread   = std::min(duration_cast<µSeconds>(Interval * PacedShare),
+		                               duration_cast<µSeconds>(MaxPacedSpread));
+		if (Spread == µSeconds{ 0 })
+			return Pacer_.Rate_;
+		return static_cast<std::uint64_t>(Bytes / duration<double>{ Spread }.count());
+	}
+
+	net::tPacer Pacer_;
+	µSeconds Last_{ 0 };
+};
+
+// what the server and a client agreed upon when the connection started.
+// clients that don't greet get version 1 frames in any pixel format, without any
+// features.
+// the viewport of a client is taken within sane bounds. negative sizes are no bounds.
+// degraded streams carry frames no larger than thumbnails to save on bytes and CPU.
+
+struct Agreement {
+	Agreement(const std::optional<protocol::Hello> & Hello, protocol::tFeatures Features)
+	: Hello_{ bounded(Hello.value_or(protocol::Hello{ .Version_ = 1 })) }
+	, Terms_{ Hello ? protocol::agreeOn(*Hello, Features)
+	                : protocol::Welcome{ .Features_ = protocol::FormatRGBA |
+	                                                  protocol::FormatBGRA } }
+	, Mirror_{ Terms_.has(protocol::ContentCache) ? Hello_.CacheBudget_ * 1024ull : 0u } {
+	}
+
+	[[nodiscard]] bool has(protocol::Feature Wanted) const noexcept {
+		return Terms_.has(Wanted);
+	}
+
+	static auto bounded(protocol::Hello Hello) noexcept -> protocol::Hello {
+		Hello.ViewportWidth_  = std::clamp(Hello.ViewportWidth_, 0, MaxViewport);
+		Hello.ViewportHeight_ = std::clamp(Hello.ViewportHeight_, 0, MaxViewport);
+		return Hello;
+	}
+
+	// the frames fit into the client's viewport, in a pixel format that it can present
+	[[nodiscard]] auto fitting() const noexcept -> Fitting {
+		Fitting Target{ .Formats_ = Terms_.Features_, .isHashed_ = Mirror_.isEnabled() };
+		if (has(protocol::Downscale)) {
+			Target.MaxWidth_  = Hello_.ViewportWidth_;
+			Target.MaxHeight_ = Hello_.ViewportHeight_;
+		}
+		if (Degraded_) {
+			const auto degrade = [](int Bound, int Degraded) {
+				return Bound > 0 ? std::min(Bound, Degraded) : Degraded;
+			};
+			Target.MaxWidth_  = degrade(Target.MaxWidth_, DegradedWidth);
+			Target.MaxHeight_ = degrade(Target.MaxHeight_, DegradedHeight);
+		}
+		return Target;
+	}
+
+	protocol::Hello Hello_;
+	protocol::Welcome Terms_;
+	CacheMirror Mirror_;
+	EgressPace Pace_;               // of network connections
+	protocol::FrameTrailer Answer_; // to the most recent clock probe
+	bool Degraded_ = false;
+};
+
+// pick up the playhead of the session of a greeting client. it is positioned right
+// after the last frame that the client has presented, within the media file that the
+// frame came from, if the session is known. clients with compact frame headers know
+// no media files, they resume within the latest one.
+// returns the playhead and the elapsed time within the media file that it points to.
+
+auto resumeSession(asio::execution_context & Context, const Agreement & Peer)
+    -> std::pair<std::shared_ptr<SessionPlayhead>, µSeconds> {
+	const auto & Hello = Peer.Hello_;
+	if (not Peer.has(protocol::Resume) or Hello.Session_ == 0)
+		return { std::make_shared<SessionPlayhead>(), µSeconds{ 0 } };
+
+	auto Position       = asio::use_service<Sessions>(Context).join(Hello.Session_);
+	const auto * Latest = Position->Media_.empty() ? nullptr : &Position->Media_;
+	const auto * Media  = Hello.Media_ == 0 ? Latest : Position->played(Hello.Media_);
+	const bool isResuming = Hello.wantsResume() and Media != nullptr;
+	if (isResuming and Media != Latest)
+		Position->Media_ = *Media;
+	Position->Sequence_ = isResuming ? Hello.Sequence_ : 0;
+	return { std::move(Position), isResuming ? Hello.Timestamp_ : µSeconds{ 0 } };
+}
+
+// create a closure with a call operator that returns the time point taylored to each
 // given frame.
-// the awaitable can then be co_awaited and execution of the awaiter will resume at
-// exactly that time that the given frame is supposed to be sent out.
+// that is exactly the time when the given frame is supposed to be sent out.
+// a resumed stream starts at the 'Elapsed' time into the media file.
 
-[[nodiscard]] auto makeStartingGate(net::tTimer & Timer) {
+[[nodiscard]] auto makeStartingGate(µSeconds Elapsed) {
 	using std::chrono::steady_clock;
-	auto StartTime = steady_clock::now();
-	auto Timestamp = video::FrameHeader::µSeconds{ 0 };
+	auto StartTime = steady_clock::now() - Elapsed;
+	auto Timestamp = Elapsed;
 
-	return [=, &Timer](const video::Frame & Frame) mutable {
+	return [=](const video::Frame & Frame) mutable {
 		const auto & Header = Frame.Header_;
 		const auto DueTime =
 		    StartTime + (Header.isFiller() ? Timestamp : Header.Timestamp_);
 		if (Header.isFirstFrame())
 			StartTime = steady_clock::now();
 		Timestamp = Header.Timestamp_;
-		Timer.expires_at(DueTime);
-		return Timer.async_wait();
+		return DueTime;
+	};
+}
+
+// a write that falls short of the 'Expected' bytes has failed
+
+auto completely(net::tExpectSize Written, std::size_t Expected) -> net::tExpectSize {
+	if (Written and *Written != Expected)
+		return std::unexpected{ std::make_error_code(std::errc::io_error) };
+	return Written;
+}
+
+// network clients get frame headers in the negotiated version.
+// clients with a cache get the pixels of each distinct frame only once. the 'Mirror'
+// tracks the contents of the client's cache.
+// all frames go out in a single gathering write. the socket is corked meanwhile such
+// that the frames are packed densely into network segments. the write is paced.
+// clients that probe the latency get a trailer after each frame.
+// the frames take as many bytes as were actually written, cached pixels take none.
+
+auto sendFrames(net::tSocket & Socket, net::tTimer & Timer,
+                std::span<const video::Frame> Frames,
+                std::span<const protocol::tClockTime> Decoded, Agreement & Peer)
+    -> asio::awaitable<net::tExpectSize> {
+	using enum protocol::ContentTag::Payload;
+	const bool isCompact = Peer.Terms_.hasCompactHeaders();
+	const bool isProbed  = Peer.has(protocol::LatencyProbe);
+	auto & Mirror        = Peer.Mirror_;
+
+	// the buffers refer to the headers, tags, and trailers, these must stay put
+	std::vector<video::FrameHeaderV1> Compacts;
+	std::vector<protocol::ContentTag> Tags;
+	std::vector<protocol::FrameTrailer> Trailers;
+	std::vector<asio::const_buffer> Buffers;
+	Compacts.reserve(Frames.size());
+	Tags.reserve(Frames.size());
+	Trailers.reserve(isProbed ? Frames.size() : 0);
+	Buffers.reserve(4 * Frames.size());
+
+	// the trailers are filled in right before the write
+	const auto addTrailer = [&](std::size_t Index) {
+		if (not isProbed)
+			return;
+		auto & Trailer    = Trailers.emplace_back(Peer.Answer_);
+		Trailer.Decoded_  = Decoded[Index];
+		Buffers.push_back(net::asBytes(Trailer));
 	};
+
+	for (std::size_t Index = 0; Index < Frames.size(); ++Index) {
+		const auto & Frame  = Frames[Index];
+		const auto & Header = Frame.Header_;
+		if (isCompact)
+			Buffers.push_back(net::asBytes(Compacts.emplace_back(compacted(Header))));
+		else
+			Buffers.push_back(net::asBytes(Header));
+		if (not Mirror.isEnabled()) {
+			Buffers.push_back(asio::buffer(Frame.Pixels_));
+			addTrailer(Index);
+			continue;
+		}
+		// later frames of the same batch may refer to the pixels of earlier ones
+		const bool isCached = Mirror.find(Frame.Hash_) != nullptr;
+		if (not isCached)
+			Mirror.insert(Frame.Hash_, Frame.Pixels_.size(), {});
+		const protocol::ContentTag Tag{ .Hash_   = Frame.Hash_,
+			                            .Pixels_ = isCached ? Cached : Attached };
+		Buffers.push_back(net::asBytes(Tags.emplace_back(Tag)));
+		Buffers.push_back(asio::buffer(isCached ? video::tPixels{} : Frame.Pixels_));
+		addTrailer(Index);
+	}
+
+	const auto Sent = protocol::clockTime(Clock::now());
+	for (auto & Trailer : Trailers)
+		Trailer.Sent_ = Sent;
+	auto & Pace      = Peer.Pace_;
+	const auto Bytes = asio::buffer_size(Buffers);
+	net::pace(Socket, Pace.Pacer_, Pace.rateOf(Bytes, Frames.back().Header_));
+	const auto Corked = Frames.size() > 1;
+	if (Corked)
+		net::cork(Socket, true);
+	const auto Written = co_await net::sendTo(Socket, Timer, Buffers, Pace.Pacer_);
+	if (Corked)
+		net::cork(Socket, false);
+	co_return completely(Written, Bytes);
+}
+
+auto sendFrame(inprocess::tConnection & Connection, net::tTimer & Timer,
+               const video::Frame & Frame, Agreement &)
+    -> asio::awaitable<net::tExpectSize> {
+	co_return co_await inprocess::sendTo(Connection, Timer, Frame);
+}
+
+auto sendFrame(shm::tConnection & Connection, net::tTimer & Timer,
+               const video::Frame & Frame, Agreement &)
+    -> asio::awaitable<net::tExpectSize> {
+	co_return co_await shm::sendTo(Connection, Timer, Frame);
+}
+
+// the other connections take one frame after the other.
+
+auto sendFrames(auto & Connection, net::tTimer & Timer,
+                std::span<const video::Frame> Frames,
+                std::span<const protocol::tClockTime>, Agreement & Peer)
+    -> asio::awaitable<net::tExpectSize> {
+	std::size_t Bytes = 0;
+	for (const auto & Frame : Frames) {
+		const auto Written = completely(
+		    co_await sendFrame(Connection, Timer, Frame, Peer), Frame.TotalSize());
+		if (not Written)
+			co_return Written;
+		Bytes += *Written;
+	}
+	co_return Bytes;
+}
+
+// frames that are due already are collected into a batch for clients that agreed upon
+// batching. a batch goes out when the next frame is not yet due, or when it is full.
+// this saves many small writes if frames are small and come at high rates.
+// the 'Load' learns about the bytes and frames that went out, once they did.
+
+struct Batch {
+	explicit Batch(Admission & Load) noexcept
+	: Load_{ Load } {}
+
+	void add(const video::Frame & Frame, protocol::tClockTime Decoded) {
+		Bytes_ += Frame.TotalSize();
+		Frames_.push_back(video::makeShared(Frame)); // outlive the generator step
+		Decoded_.push_back(Decoded);
+	}
+	[[nodiscard]] bool isFull() const noexcept {
+		return Frames_.size() >= MaxBatchFrames or Bytes_ >= MaxBatchBytes;
+	}
+
+	auto flush(auto & Client, net::tTimer & Timer, Agreement & Peer)
+	    -> asio::awaitable<bool> {
+		if (Frames_.empty())
+			co_return true;
+		Timer.expires_after(SendTimeBudget);
+		const auto Sent = co_await sendFrames(Client, Timer, Frames_, Decoded_, Peer);
+		if (Sent) {
+			Load_.sent(*Sent);
+			metrics::countFrame(metrics::Passage::sent, Frames_.size());
+		}
+		Frames_.clear();
+		Decoded_.clear();
+		Bytes_ = 0;
+		co_return Sent.has_value();
+	}
+
+private:
+	Admission & Load_;
+	std::vector<video::Frame> Frames_;
+	std::vector<protocol::tClockTime> Decoded_;
+	std::size_t Bytes_ = 0;
+};
+
+// clients that probe the latency send clock probes every now and then. each one is
+// answered with the trailers of the frames that follow. the client is gone when the
+// probes stop coming.
+
+[[nodiscard]] auto answerProbes(net::tSocket & Socket, Agreement & Peer)
+    -> asio::awaitable<void> {
+	for (;;) {
+		protocol::ClockProbe Probe;
+		const auto Bytes = std::as_writable_bytes(std::span{ &Probe, 1 });
+		const auto [Error, Size] = co_await asio::async_read(Socket, asio::buffer(Bytes));
+		if (Error or not Probe.isValid())
+			co_return;
+		Peer.Answer_.Probed_   = Probe.Sent_;
+		Peer.Answer_.Received_ = protocol::clockTime(Clock::now());
+	}
+}
+
+// the frames of the 'Source' go out when they are due.
+
+[[nodiscard]] auto playVideos(auto & Client, net::tTimer & Timer, Agreement & Peer,
+                              fs::path Source) -> asio::awaitable<void> {
+	auto & Context           = Timer.get_executor().context();
+	auto [Position, Elapsed] = resumeSession(Context, Peer);
+	auto & Load              = asio::use_service<Admission>(Context);
+	auto & Decoder           = asio::use_service<Decoding>(Context);
+	auto Frames = Decoder.decode(std::move(Source), *Position, Peer.fitting());
+
+	auto DueTime = makeStartingGate(Elapsed);
+	Batch Pending{ Load };
+	while (auto Decoded = co_await Frames.next()) {
+		if (Decoded->Playing_)
+			Position->moveInto(std::move(*Decoded->Playing_));
+		const auto & Frame = Decoded->Frame_;
+		const auto Due     = DueTime(Frame);
+		if (Due > std::chrono::steady_clock::now()) {
+			if (not co_await Pending.flush(Client, Timer, Peer))
+				co_return;
+			Timer.expires_at(Due);
+			co_await Timer.async_wait();
+		}
+
+		Pending.add(Frame, Decoded->Decoded_);
+		if (not Peer.has(protocol::Batching) or Pending.isFull()) {
+			if (not co_await Pending.flush(Client, Timer, Peer))
+				co_return;
+		}
+	}
+	co_await Pending.flush(Client, Timer, Peer);
 }
 
 // the connection is implemented as an independent coroutine.
 // it will be brought down by internal events or from the outside using a
 // stop signal.
+// the connection is either a network socket, a same-host connection through shared
+// memory, or an in-process channel.
+// the terms of the connection are negotiated first. a reconnecting client continues
+// where its previous connection left off. network clients that probe the latency are
+// answered alongside.
+// the connection holds on to its 'Seat' as long as it lasts.
 
-[[nodiscard]] auto streamVideos(net::tSocket Socket, fs::path Source)
+template <typename Connection>
+[[nodiscard]] auto streamVideos(Connection Client, fs::path Source, Pass Seat)
     -> asio::awaitable<void> {
-	net::tTimer Timer(Socket.get_executor());
-	const auto WatchDog = executor::abort(Socket, Timer);
+	net::tTimer Timer(Client.get_executor());
+	const auto WatchDog = executor::abort(Client, Timer);
 
-	auto DueTime = makeStartingGate(Timer);
-	for (const auto Frame : video::makeFrames(std::move(Source))) {
-		co_await DueTime(Frame);
+	Timer.expires_after(HelloTimeBudget);
+	const auto Hello = co_await receiveHello(Client, Timer);
+	Agreement Peer{ Hello, SupportedOn<Connection> };
+	Peer.Degraded_ = Seat.Degraded_;
+	Timer.expires_after(SendTimeBudget);
+	if (Hello and not co_await sendWelcome(Client, Timer, Peer.Terms_))
+		co_return;
 
-		net::tSendBuffers<2> Buffers{ net::asBytes(Frame.Header_),
-			                          asio::buffer(Frame.Pixels_) };
-		Timer.expires_after(SendTimeBudget);
-		if (Frame.TotalSize() != co_await net::sendTo(Socket, Timer, Buffers))
-			break;
+	if constexpr (std::is_same_v<Connection, net::tSocket>) {
+		if (Peer.has(protocol::LatencyProbe)) {
+			using net::operator||;
+			co_await (playVideos(Client, Timer, Peer, std::move(Source)) ||
+			          answerProbes(Client, Peer));
+			co_return;
+		}
 	}
+	co_await playVideos(Client, Timer, Peer, std::move(Source));
 }
 
 // the tcp acceptor is a coroutine.
-// it spawns new, independent coroutines on connect.
+// it spawns new, independent coroutines on connect if the clients are admitted.
+// clients within the same process are accepted at the same endpoint, too.
 
 [[nodiscard]] auto acceptConnections(net::tAcceptor Acceptor, const fs::path Source)
     -> asio::awaitable<void> {
 	const auto WatchDog = executor::abort(Acceptor);
+	auto & Load         = asio::use_service<Admission>(Acceptor.get_executor().context());
+	const auto Seats    = std::make_shared<unsigned>(0);
+	const auto Labelled = executor::labelled(Acceptor, "streamVideos", Networking);
+
+	const auto acceptLocally = [&](inprocess::tConnection Connection) {
+		if (auto Seat = Load.admit(Seats))
+			executor::commission(Labelled, streamVideos<inprocess::tConnection>,
+			                     std::move(Connection), Source, std::move(*Seat));
+	};
+	const auto Local = inprocess::listen(Acceptor.get_executor().context(),
+	                                     Acceptor.local_endpoint(), acceptLocally);
+
+	while (Acceptor.is_open()) {
+		auto [Error, Socket] = co_await Acceptor.async_accept();
+		if (Error or not Socket.is_open())
+			continue;
+		auto Seat = Load.admit(Seats);
+		if (not Seat)
+			continue; // refused clients are disconnected right away
+		// batches are corked explicitly, single frames must not wait for more to come
+		Socket.set_option(asio::ip::tcp::no_delay{ true }, Error);
+		executor::commission(Labelled, streamVideos<net::tSocket>, std::move(Socket),
+		                     Source, std::move(*Seat));
+	}
+}
+
+// the AF_UNIX acceptor for same-host clients.
+// those get their frames through shared memory.
+
+[[nodiscard]] auto acceptLocalConnections(net::tLocalAcceptor Acceptor,
+                                          const fs::path Source)
+    -> asio::awaitable<void> {
+	const auto WatchDog   = executor::abort(Acceptor);
+	const auto Rendezvous = Acceptor.local_endpoint().path();
+	auto & Context        = Acceptor.get_executor().context();
+	auto & Load           = asio::use_service<Admission>(Context);
+	const auto Seats      = std::make_shared<unsigned>(0);
+	const auto Labelled   = executor::labelled(Acceptor, "streamVideos", Networking);
 
 	while (Acceptor.is_open()) {
 		auto [Error, Socket] = co_await Acceptor.async_accept();
-		if (not Error and Socket.is_open())
-			executor::commission(Acceptor.get_executor(), streamVideos, std::move(Socket),
-			                     Source);
+		if (Error or not Socket.is_open())
+			continue;
+		if (auto Seat = Load.admit(Seats))
+			executor::commission(Labelled, streamVideos<shm::tConnection>,
+			                     shm::tConnection{ std::move(Socket) }, Source,
+			                     std::move(*Seat));
+	}
+	std::error_code Ignored;
+	fs::remove(Rendezvous, Ignored);
+}
+
+// serving same-host clients through AF_UNIX sockets is optional. these clients can
+// always fall back to tcp. another server that is still running at the rendezvous point
+// keeps it.
+
+void serveLocally(asio::io_context & Context, net::tPort Port, const fs::path & Source) {
+	const auto Endpoint = net::localEndpoint(Port);
+	if (not Endpoint or not net::clearRendezvous(Context, *Endpoint))
+		return;
+
+	try {
+		executor::commission(executor::labelled(Context, "acceptLocalConnections",
+		                                        Networking),
+		                     acceptLocalConnections,
+		                     net::tLocalAcceptor{ Context, *Endpoint }, Source);
+		std::println("accept connections at {}", Endpoint->path());
+	} catch (const std::system_error &) {
 	}
 }
 
 // start serving a list of given endpoints.
 // each endpoint is served by an independent coroutine.
+// the server takes on no more load than the given 'Limits' allow, and it reads the
+// media files as given by 'Reading'.
 
 export auto serve(asio::io_context & Context, net::tEndpoints Endpoints,
-                  const fs::path Source) -> net::tExpectSize {
+                  const fs::path Source, const tLimits & Limits,
+                  const video::tReading & Reading) -> net::tExpectSize {
+	asio::use_service<Admission>(Context).limitTo(Limits);
+	asio::use_service<Decoding>(Context).readWith(Reading);
 	std::size_t NumberOfAcceptors = 0;
 	auto Error = std::make_error_code(std::errc::function_not_supported);
 
 	for (const auto & Endpoint : Endpoints) {
 		try {
-			executor::commission(Context, acceptConnections,
+			executor::commission(executor::labelled(Context, "acceptConnections",
+			                                        Networking),
+			                     acceptConnections,
 			                     net::tAcceptor{ Context, Endpoint }, Source);
 			std::println("accept connections at {}", Endpoint.address().to_string());
 			++NumberOfAcceptors;
@@ -90,6 +901,9 @@ export auto serve(asio::io_context & Context, net::tEndpoints Endpoints,
 	}
 	if (NumberOfAcceptors == 0)
 		return std::unexpected{ Error };
+	executor::commission(executor::labelled(Context, "probeLoad"), probeLoad, Context);
+	if (shm::isSupported() and rgs::any_of(Endpoints, net::isOnThisHost))
+		serveLocally(Context, net::tPort{ Endpoints.front().port() }, Source);
 	return NumberOfAcceptors;
 }
 } // namespace server
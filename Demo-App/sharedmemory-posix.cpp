@@ -0,0 +1,142 @@
+module;
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#	error this is not POSIX!
+#endif
+
+module sharedmemory;
+import std;
+
+import net;
+
+namespace shm {
+
+#ifdef MSG_NOSIGNAL
+static constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int SendFlags = 0;
+#endif
+#ifdef MSG_CMSG_CLOEXEC
+static constexpr int ReceiveFlags = MSG_CMSG_CLOEXEC;
+#else
+static constexpr int ReceiveFlags = 0;
+#endif
+
+static auto lastError() noexcept {
+	return std::error_code{ errno, std::system_category() };
+}
+
+// an anonymous file that lives in memory only. it disappears as soon as the last
+// handle to it is closed and the last mapping is gone.
+
+static int createAnonymousFile() noexcept {
+#ifdef __linux__
+	return memfd_create("CppInAction", MFD_CLOEXEC);
+#else
+	static std::atomic<unsigned> Counter = 0;
+	const auto Name  = std::format("/CppInAction-{}-{}", getpid(), Counter++);
+	const int Handle = shm_open(Name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (Handle >= 0)
+		shm_unlink(Name.c_str());
+	return Handle;
+#endif
+}
+
+bool isSupported() noexcept {
+	return true;
+}
+
+auto createRegion(std::size_t Size) -> net::tExpected<tRegion> {
+	const int Handle = createAnonymousFile();
+	if (Handle < 0)
+		return std::unexpected{ lastError() };
+	if (ftruncate(Handle, static_cast<off_t>(Size)) != 0) {
+		const auto Error = lastError();
+		::close(Handle);
+		return std::unexpected{ Error };
+	}
+	return mapRegion(Handle, Size, Access::ReadWrite);
+}
+
+// the region takes ownership of the given 'Handle' in any case
+
+auto mapRegion(int Handle, std::size_t Size, Access Mode) -> net::tExpected<tRegion> {
+	const int Protection =
+	    Mode == Access::ReadWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+	void * Base = mmap(nullptr, Size, Protection, MAP_SHARED, Handle, 0);
+	if (Base == MAP_FAILED) {
+		const auto Error = lastError();
+		::close(Handle);
+		return std::unexpected{ Error };
+	}
+	return tRegion{ static_cast<std::byte *>(Base), Size, Handle };
+}
+
+void unmapRegion(tRegion & Region) noexcept {
+	if (Region.Base_ != nullptr)
+		munmap(Region.Base_, Region.Size_);
+	if (Region.Handle_ != NoHandle)
+		::close(Region.Handle_);
+}
+
+// pass the 'Handle' along with the 'Bytes' as ancillary data (SCM_RIGHTS)
+
+auto sendWithHandle(net::tLocalSocket & Socket, net::tConstByteSpan Bytes, int Handle)
+    -> net::tExpectSize {
+	iovec Data{ .iov_base = const_cast<std::byte *>(Bytes.data()),
+		        .iov_len  = Bytes.size() };
+	alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(Handle))] = {};
+
+	msghdr Message{};
+	Message.msg_iov        = &Data;
+	Message.msg_iovlen     = 1;
+	Message.msg_control    = Control;
+	Message.msg_controllen = sizeof(Control);
+
+	cmsghdr * Ancillary   = CMSG_FIRSTHDR(&Message);
+	Ancillary->cmsg_level = SOL_SOCKET;
+	Ancillary->cmsg_type  = SCM_RIGHTS;
+	Ancillary->cmsg_len   = CMSG_LEN(sizeof(Handle));
+	std::memcpy(CMSG_DATA(Ancillary), &Handle, sizeof(Handle));
+
+	const auto Sent = ::sendmsg(Socket.native_handle(), &Message, SendFlags);
+	if (Sent < 0)
+		return std::unexpected{ lastError() };
+	return static_cast<std::size_t>(Sent);
+}
+
+// receive some bytes into 'Space', picking up a passed handle on the way
+
+auto receiveWithHandle(net::tLocalSocket & Socket, net::tByteSpan Space, int & Handle)
+    -> net::tExpectSize {
+	iovec Data{ .iov_base = Space.data(), .iov_len = Space.size() };
+	alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(Handle))];
+
+	msghdr Message{};
+	Message.msg_iov        = &Data;
+	Message.msg_iovlen     = 1;
+	Message.msg_control    = Control;
+	Message.msg_controllen = sizeof(Control);
+
+	const auto Received = ::recvmsg(Socket.native_handle(), &Message, ReceiveFlags);
+	if (Received < 0)
+		return std::unexpected{ lastError() };
+
+	for (auto * Ancillary = CMSG_FIRSTHDR(&Message); Ancillary != nullptr;
+	     Ancillary = CMSG_NXTHDR(&Message, Ancillary)) {
+		if (Ancillary->cmsg_level == SOL_SOCKET and Ancillary->cmsg_type == SCM_RIGHTS) {
+			if (Handle != NoHandle)
+				::close(Handle);
+			std::memcpy(&Handle, CMSG_DATA(Ancillary), sizeof(Handle));
+		}
+	}
+	return static_cast<std::size_t>(Received);
+}
+
+} // namespace shm
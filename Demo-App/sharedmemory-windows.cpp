@@ -0,0 +1,43 @@
+module;
+
+#ifndef _WIN32
+#	error this is not Windows!
+#endif
+
+module sharedmemory;
+import std;
+
+import net;
+
+// passing memory handles through AF_UNIX sockets is not available on Windows.
+// same-host clients fall back to TCP.
+
+namespace shm {
+
+static auto notSupported() {
+	return std::unexpected{ std::make_error_code(std::errc::function_not_supported) };
+}
+
+bool isSupported() noexcept {
+	return false;
+}
+
+auto createRegion(std::size_t) -> net::tExpected<tRegion> {
+	return notSupported();
+}
+
+auto mapRegion(int, std::size_t, Access) -> net::tExpected<tRegion> {
+	return notSupported();
+}
+
+void unmapRegion(tRegion &) noexcept {}
+
+auto sendWithHandle(net::tLocalSocket &, net::tConstByteSpan, int) -> net::tExpectSize {
+	return notSupported();
+}
+
+auto receiveWithHandle(net::tLocalSocket &, net::tByteSpan, int &) -> net::tExpectSize {
+	return notSupported();
+}
+
+} // namespace shm
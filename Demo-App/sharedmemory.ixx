@@ -0,0 +1,338 @@
+export module sharedmemory;
+import std;
+
+import asio;
+import libav;
+import net;
+import video;
+
+// a same-host transport on top of AF_UNIX sockets.
+//
+// the pixels of each frame are written once by the server into a memory region that is
+// shared with the client, and read in place by the client. only small messages go
+// through the socket:
+//  - the server hands out a new memory region (its handle) whenever frames outgrow it
+//  - the server announces each frame together with the slot that holds its pixels
+//  - the client gives slots back when it is done with the pixels (the doorbell)
+
+namespace shm {
+using tSlot = std::uint32_t;
+
+static constexpr auto SlotCount = 3u;
+static constexpr auto NoSlot    = tSlot{ 0xFFFF'FFFFu };
+static constexpr auto PageSize  = std::size_t{ 4096 };
+static constexpr auto NoHandle  = -1;
+
+// memory that is mapped into the address spaces of both server and client
+
+struct tRegion {
+	tRegion() noexcept = default;
+	tRegion(std::byte * Base, std::size_t Size, int Handle) noexcept
+	: Base_{ Base }
+	, Size_{ Size }
+	, Handle_{ Handle } {}
+	tRegion(tRegion && Other) noexcept
+	: Base_{ std::exchange(Other.Base_, nullptr) }
+	, Size_{ std::exchange(Other.Size_, 0) }
+	, Handle_{ std::exchange(Other.Handle_, NoHandle) } {}
+	tRegion & operator=(tRegion && Other) noexcept {
+		std::swap(Base_, Other.Base_);
+		std::swap(Size_, Other.Size_);
+		std::swap(Handle_, Other.Handle_);
+		return *this;
+	}
+	~tRegion();
+
+	std::byte * Base_ = nullptr;
+	std::size_t Size_ = 0;
+	int Handle_       = NoHandle;
+};
+
+enum class Access : bool { ReadOnly, ReadWrite };
+
+// the platform-specific parts
+
+export bool isSupported() noexcept;
+auto createRegion(std::size_t Size) -> net::tExpected<tRegion>;
+auto mapRegion(int Handle, std::size_t Size, Access) -> net::tExpected<tRegion>;
+void unmapRegion(tRegion & Region) noexcept;
+auto sendWithHandle(net::tLocalSocket & Socket, net::tConstByteSpan Bytes, int Handle)
+    -> net::tExpectSize;
+auto receiveWithHandle(net::tLocalSocket & Socket, net::tByteSpan Space, int & Handle)
+    -> net::tExpectSize;
+
+tRegion::~tRegion() {
+	unmapRegion(*this);
+}
+
+// the messages from the server to the client.
+// after the handshake, messages from the client to the server are just the slots that
+// are given back.
+
+struct Message {
+	enum Kind : std::uint32_t { Frame, Region };
+
+	Kind Kind_;
+	tSlot Slot_; // the size of each slot in case of a new region
+	video::FrameHeader Header_;
+};
+static_assert(std::is_trivially_copyable_v<Message>);
+
+// the client hands out the pixels in the shared memory region as frames. the slot is
+// given back as soon as the last holder of a frame lets go of it.
+
+struct Lease {
+	std::shared_ptr<tRegion> Region_;
+	std::shared_ptr<std::vector<tSlot>> Released_;
+	tSlot Slot_;
+};
+
+void giveBack(void * Opaque, std::uint8_t *) {
+	const std::unique_ptr<Lease> Loan{ static_cast<Lease *>(Opaque) };
+	Loan->Released_->push_back(Loan->Slot_);
+}
+
+constexpr auto roundUpToPages(std::size_t Size) {
+	return (Size + PageSize - 1) / PageSize * PageSize;
+}
+
+auto asWritableBytes(auto & Object) noexcept -> net::tByteSpan {
+	return std::as_writable_bytes(std::span{ &Object, 1 });
+}
+
+auto errorFrom(const auto & WaitResult) -> std::error_code {
+	if (WaitResult.index() != 0)
+		return std::make_error_code(std::errc::timed_out);
+	return std::get<0>(std::get<0>(WaitResult));
+}
+
+export {
+	// one end of a same-host connection, supporting the same operations that are
+	// required from a socket
+
+	struct tConnection {
+		explicit tConnection(net::tLocalSocket Socket)
+		: Socket_{ std::move(Socket) } {}
+
+		[[nodiscard]] bool is_open() const noexcept { return Socket_.is_open(); }
+		[[nodiscard]] auto get_executor() { return Socket_.get_executor(); }
+
+		net::tLocalSocket Socket_;
+		std::shared_ptr<tRegion> Region_;
+		std::size_t SlotSize_ = 0;
+		std::bitset<SlotCount> Busy_;                   // server side
+		std::shared_ptr<std::vector<tSlot>> Released_ = // client side
+		    std::make_shared<std::vector<tSlot>>();
+	};
+
+	void close(tConnection & Connection) noexcept {
+		net::close(Connection.Socket_);
+	}
+} // export
+
+// server side
+
+void release(tConnection & Connection, tSlot Slot) noexcept {
+	if (Slot < SlotCount)
+		Connection.Busy_.reset(Slot);
+}
+
+void collectReleasedSlots(tConnection & Connection) {
+	std::error_code Error;
+	tSlot Slot;
+	while (Connection.Socket_.available(Error) >= sizeof(Slot) and not Error) {
+		asio::read(Connection.Socket_, asio::buffer(asWritableBytes(Slot)), Error);
+		if (not Error)
+			release(Connection, Slot);
+	}
+}
+
+auto awaitReleasedSlot(tConnection & Connection, net::tTimer & Timer)
+    -> asio::awaitable<bool> {
+	tSlot Slot;
+	const auto Got =
+	    co_await net::receiveFrom(Connection.Socket_, Timer, asWritableBytes(Slot));
+	if (Got != sizeof(Slot))
+		co_return false;
+	release(Connection, Slot);
+	co_return true;
+}
+
+auto provideRegion(tConnection & Connection, net::tTimer & Timer, std::size_t Size)
+    -> asio::awaitable<std::error_code> {
+	const auto SlotSize = roundUpToPages(Size);
+	auto Region         = createRegion(SlotSize * SlotCount);
+	if (not Region)
+		co_return Region.error();
+
+	const Message Announcement{ .Kind_ = Message::Region,
+		                        .Slot_ = static_cast<tSlot>(SlotSize) };
+	auto Bytes = std::as_bytes(std::span{ &Announcement, 1 });
+	const auto Writable =
+	    co_await (Connection.Socket_.async_wait(net::tLocalSocket::wait_write) ||
+	              Timer.async_wait());
+	if (const auto Error = errorFrom(Writable))
+		co_return Error;
+	const auto Sent = sendWithHandle(Connection.Socket_, Bytes, Region->Handle_);
+	if (not Sent)
+		co_return Sent.error();
+
+	// the handle went with the first byte, the rest (if any) is just data
+	if (Bytes = Bytes.subspan(*Sent); not Bytes.empty()) {
+		net::tSendBuffers<1> Rest{ asio::buffer(Bytes) };
+		const auto Done = co_await net::sendTo(Connection.Socket_, Timer, Rest);
+		if (not Done)
+			co_return Done.error();
+	}
+	Connection.Region_   = std::make_shared<tRegion>(std::move(Region).value());
+	Connection.SlotSize_ = SlotSize;
+	Connection.Busy_.reset();
+	co_return std::error_code{};
+}
+
+auto firstFreeSlot(const tConnection & Connection) -> tSlot {
+	tSlot Slot = 0;
+	while (Connection.Busy_.test(Slot))
+		++Slot;
+	return Slot;
+}
+
+// client side
+
+auto receiveMessage(tConnection & Connection, net::tTimer & Timer, Message & Announcement,
+                    int & Handle) -> asio::awaitable<std::error_code> {
+	for (auto Space = asWritableBytes(Announcement); not Space.empty();) {
+		const auto Readable =
+		    co_await (Connection.Socket_.async_wait(net::tLocalSocket::wait_read) ||
+		              Timer.async_wait());
+		if (const auto Error = errorFrom(Readable))
+			co_return Error;
+
+		const auto Got = receiveWithHandle(Connection.Socket_, Space, Handle);
+		if (not Got) {
+			if (Got.error() == std::errc::operation_would_block)
+				continue;
+			co_return Got.error();
+		}
+		if (*Got == 0)
+			co_return std::make_error_code(std::errc::connection_reset);
+		Space = Space.subspan(*Got);
+	}
+	co_return std::error_code{};
+}
+
+auto acceptRegion(tConnection & Connection, const Message & Announcement, int Handle)
+    -> std::error_code {
+	if (Handle == NoHandle)
+		return std::make_error_code(std::errc::bad_message);
+
+	const auto SlotSize = std::size_t{ Announcement.Slot_ };
+	auto Region         = mapRegion(Handle, SlotSize * SlotCount, Access::ReadOnly);
+	if (not Region)
+		return Region.error();
+	Connection.Region_   = std::make_shared<tRegion>(std::move(Region).value());
+	Connection.SlotSize_ = SlotSize;
+	return {};
+}
+
+auto lendPixels(tConnection & Connection, const Message & Announcement)
+    -> net::tExpected<video::Frame> {
+	video::Frame Frame{ Announcement.Header_ };
+	const auto Size = Frame.Header_.SizePixels();
+	const auto Slot = Announcement.Slot_;
+	if (Slot == NoSlot and Size == 0)
+		return Frame;
+	if (Slot >= SlotCount or not Connection.Region_ or Size > Connection.SlotSize_)
+		return std::unexpected{ std::make_error_code(std::errc::bad_message) };
+
+	const auto Offset = Slot * Connection.SlotSize_;
+	const auto Pixels = std::span{ Connection.Region_->Base_ + Offset, Size };
+	auto Loan = std::make_unique<Lease>(Connection.Region_, Connection.Released_, Slot);
+	Frame.Owner_.reset(av_buffer_create(std::bit_cast<std::uint8_t *>(Pixels.data()),
+	                                    Size, giveBack, Loan.get(), 0));
+	if (not have(Frame.Owner_))
+		return std::unexpected{ std::make_error_code(std::errc::not_enough_memory) };
+	Loan.release(); // now owned by the frame
+	Frame.Pixels_ = Pixels;
+	return Frame;
+}
+
+// claim a slot that is large enough to hold 'Size' bytes. a larger region replaces the
+// current one, once the client has given back all slots.
+
+auto claimSlot(tConnection & Connection, net::tTimer & Timer, std::size_t Size)
+    -> asio::awaitable<net::tExpected<tSlot>> {
+	const auto TimedOut = std::unexpected{ std::make_error_code(std::errc::timed_out) };
+
+	collectReleasedSlots(Connection);
+	if (Size > Connection.SlotSize_) {
+		while (Connection.Busy_.any())
+			if (not co_await awaitReleasedSlot(Connection, Timer))
+				co_return TimedOut;
+		if (const auto Error = co_await provideRegion(Connection, Timer, Size))
+			co_return std::unexpected{ Error };
+	}
+	while (Connection.Busy_.all())
+		if (not co_await awaitReleasedSlot(Connection, Timer))
+			co_return TimedOut;
+
+	const auto Slot = firstFreeSlot(Connection);
+	Connection.Busy_.set(Slot);
+	co_return Slot;
+}
+
+auto flushReleasedSlots(tConnection & Connection, net::tTimer & Timer)
+    -> asio::awaitable<std::error_code> {
+	if (Connection.Released_->empty())
+		co_return std::error_code{};
+
+	const auto Slots = std::exchange(*Connection.Released_, {});
+	net::tSendBuffers<1> Doorbell{ asio::buffer(Slots) };
+	const auto Sent = co_await net::sendTo(Connection.Socket_, Timer, Doorbell);
+	co_return Sent ? std::error_code{} : Sent.error();
+}
+
+export {
+	// the same contracts as the socket-based operations in module 'net'
+
+	auto sendTo(tConnection & Connection, net::tTimer & Timer,
+	            const video::Frame & Frame) -> asio::awaitable<net::tExpectSize> {
+		Message Announcement{ .Kind_   = Message::Frame,
+			                  .Slot_   = NoSlot,
+			                  .Header_ = Frame.Header_ };
+
+		if (const auto Size = Frame.Pixels_.size(); Size > 0) {
+			const auto Slot = co_await claimSlot(Connection, Timer, Size);
+			if (not Slot)
+				co_return std::unexpected{ Slot.error() };
+			Announcement.Slot_ = *Slot;
+			std::ranges::copy(Frame.Pixels_,
+			                  Connection.Region_->Base_ + *Slot * Connection.SlotSize_);
+		}
+
+		net::tSendBuffers<1> Buffers{ net::asBytes(Announcement) };
+		const auto Sent = co_await net::sendTo(Connection.Socket_, Timer, Buffers);
+		if (not Sent)
+			co_return std::unexpected{ Sent.error() };
+		co_return Frame.TotalSize();
+	}
+
+	auto receiveFrom(tConnection & Connection, net::tTimer & Timer)
+	    -> asio::awaitable<net::tExpected<video::Frame>> {
+		if (const auto Error = co_await flushReleasedSlots(Connection, Timer))
+			co_return std::unexpected{ Error };
+
+		while (true) {
+			Message Announcement;
+			int Handle = NoHandle;
+			if (const auto Error =
+			        co_await receiveMessage(Connection, Timer, Announcement, Handle))
+				co_return std::unexpected{ Error };
+			if (Announcement.Kind_ == Message::Frame)
+				co_return lendPixels(Connection, Announcement);
+			if (const auto Error = acceptRegion(Connection, Announcement, Handle))
+				co_return std::unexpected{ Error };
+		}
+	}
+} // export
+} // namespace shm
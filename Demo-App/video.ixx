@@ -2,3 +2,4 @@ export module video;
 
 export import :frame;
 export import :decoder;
+export import :scaler;
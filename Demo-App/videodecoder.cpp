@@ -10,16 +10,115 @@ import libav;
 
 namespace fs  = std::filesystem;
 namespace rgs = std::ranges;
-namespace vws = rgs::views;
 
 // video frame generator
 // wrap the libav (a.k.a. FFmpeg https://ffmpeg.org/) C API types and their
 // assorted functions
 namespace libav {
+static constexpr auto MinBlockSize = std::size_t{ 4 } << 10; // bytes per read from libav
+static constexpr auto MaxBlockSize = std::size_t{ 16 } << 20;
+
+// media files are read through memory mappings instead of blocking file reads. the
+// mappings are prefetched sequentially in the background well ahead of libav such that
+// slow or cold storage does not stall the thread that drives the decoder.
+// the files may change on disk while they are read. a file that has shrunk ends the
+// reading with an error, before the mapping is touched where the file is gone.
+
+struct MappedInput {
+	caboodle::tMappedFile Mapped_;
+	std::size_t Prefetch_;
+	std::size_t Position_   = 0;
+	std::size_t Prefetched_ = 0;
+};
+
+int readMapped(void * Opaque, std::uint8_t * Buffer, int Size) {
+	auto & Input     = *static_cast<MappedInput *>(Opaque);
+	const auto Bytes = Input.Mapped_.bytes().subspan(Input.Position_);
+	const auto Count = std::min(Bytes.size(), static_cast<std::size_t>(Size));
+	if (Count == 0)
+		return AVERROR_EOF;
+	if (not Input.Mapped_.holds(Input.Position_ + Count))
+		return AVERROR(EIO);
+
+	if (Input.Position_ + Count + Input.Prefetch_ / 2 > Input.Prefetched_) {
+		Input.Mapped_.prefetch(Input.Prefetched_, Input.Prefetch_);
+		Input.Prefetched_ += Input.Prefetch_;
+	}
+	std::memcpy(Buffer, Bytes.data(), Count);
+	Input.Position_ += Count;
+	return static_cast<int>(Count);
+}
+
+std::int64_t seekMapped(void * Opaque, std::int64_t Offset, int Whence) {
+	auto & Input    = *static_cast<MappedInput *>(Opaque);
+	const auto Size = static_cast<std::int64_t>(Input.Mapped_.bytes().size());
+	switch (Whence & ~AVSEEK_FORCE) {
+		case AVSEEK_SIZE: return Size;
+		case SEEK_SET: break;
+		case SEEK_CUR: Offset += static_cast<std::int64_t>(Input.Position_); break;
+		case SEEK_END: Offset += Size; break;
+		default: return AVERROR(EINVAL);
+	}
+	if (Offset < 0 or Offset > Size)
+		return AVERROR(EINVAL);
+	Input.Position_   = static_cast<std::size_t>(Offset);
+	Input.Prefetched_ = std::max(Input.Prefetched_, Input.Position_);
+	return Offset;
+}
+
+void closeMapped(AVIOContext * IO) {
+	if (IO == nullptr)
+		return;
+	delete static_cast<MappedInput *>(IO->opaque);
+	av_freep(&IO->buffer);
+	avio_context_free(&IO);
+}
+
+// open a media file for reading through a memory mapping if possible, in blocks of
+// 'BlockSize' bytes with 'Prefetch' bytes ahead. otherwise libav reads the file by
+// itself.
+
+int openInput(AVFormatContext ** Context, const char * Url, const fs::path & Path,
+              std::size_t BlockSize, std::size_t Prefetch) {
+	auto Input = std::make_unique<MappedInput>(caboodle::mapFile(Path), Prefetch);
+	if (Input->Mapped_.bytes().empty())
+		return avformat_open_input(Context, Url, nullptr, nullptr);
+
+	const auto Block =
+	    static_cast<int>(std::clamp(BlockSize, MinBlockSize, MaxBlockSize));
+	auto * Buffer    = static_cast<unsigned char *>(av_malloc(Block));
+	AVIOContext * IO = nullptr;
+	if (Buffer != nullptr)
+		IO = avio_alloc_context(Buffer, Block, 0, Input.get(), readMapped, nullptr,
+		                        seekMapped);
+	if (IO != nullptr)
+		*Context = avformat_alloc_context();
+	if (*Context == nullptr) {
+		av_free(Buffer);
+		avio_context_free(&IO);
+		return AVERROR(ENOMEM);
+	}
+	Input.release(); // owned by the I/O context from now on
+	(*Context)->pb = IO;
+	(*Context)->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+	const auto Result = avformat_open_input(Context, Url, nullptr, nullptr);
+	if (Result < 0)
+		closeMapped(IO); // libav has freed the format context already
+	return Result;
+}
+
+// libav leaves custom I/O contexts alone when it closes the format context.
+
+void closeInput(AVFormatContext ** Context) {
+	auto * IO = ((*Context)->flags & AVFMT_FLAG_CUSTOM_IO) ? (*Context)->pb : nullptr;
+	avformat_close_input(Context);
+	closeMapped(IO);
+}
+
 using Codec =
     stdex::c_resource<AVCodecContext, avcodec_alloc_context3, avcodec_free_context>;
-using File =
-    stdex::c_resource<AVFormatContext, avformat_open_input, avformat_close_input>;
+using File = stdex::c_resource<AVFormatContext, openInput, closeInput>;
 using tFrame  = stdex::c_resource<AVFrame, av_frame_alloc, av_frame_free>;
 using tPacket = stdex::c_resource<AVPacket, av_packet_alloc, av_packet_free>;
 
@@ -38,23 +137,6 @@ struct [[nodiscard]] Packet : tPacket {
 
 namespace video {
 
-// generate an endless stream of paths of the lastest contents of given Directory on each
-// iteration step.
-// the returned paths are empty if there are no directory contents.
-
-auto InfinitePathSource(fs::path Directory) -> std::generator<fs::path> {
-	using fs::directory_options::skip_permission_denied;
-	std::error_code Error;
-	for (fs::directory_iterator atEnd{}, Iterator = atEnd; true;) {
-		if (Iterator == atEnd or Iterator.increment(Error) == atEnd)
-			Iterator = fs::directory_iterator{ Directory, skip_permission_denied, Error };
-		co_yield Error or Iterator == atEnd ? fs::path{} : Iterator->path();
-	}
-}
-
-static_assert(rgs::range<decltype(InfinitePathSource({}))>);
-static_assert(rgs::viewable_range<decltype(InfinitePathSource({}))>);
-
 static constexpr auto DetectStream  = -1;
 static constexpr auto FirstStream   = 0;
 static constexpr auto MainSubstream = 0;
@@ -76,58 +158,611 @@ auto acceptOnlyGIF(libav::File File) -> libav::File {
 	return File;
 }
 
-auto tryOpenAsGIF(fs::path Path) -> libav::File {
-	const auto Filename = caboodle::utf8Path(std::move(Path));
+using std::chrono::microseconds;
+
+static constexpr bool isSameTimeUnit =
+    std::is_same_v<microseconds::period, std::ratio<1, AV_TIME_BASE>>;
+static_assert(isSameTimeUnit, "libav uses different time units");
+
+auto getTickDuration(const libav::File & File) {
+	return microseconds{ av_rescale_q(1, File->streams[FirstStream]->time_base,
+		                              { 1, AV_TIME_BASE }) };
+}
+
+// what is known about a media file. 'isPlayable_' is the verdict of the probe, the
+// other properties are taken from the probe if the file is playable. playable files
+// are opened later on without probing them again.
+
+struct MediaInfo {
+	std::uint64_t Size_        = 0;
+	std::int64_t Modified_     = 0; // in ticks of the file clock
+	std::int64_t Duration_     = 0; // in µs
+	std::int64_t TickDuration_ = 0; // in µs
+	std::int32_t Width_        = 0;
+	std::int32_t Height_       = 0;
+	std::int32_t Frames_       = 0;  // zero if unknown
+	std::int16_t Format_       = -1; // of the decoded pixels, as libav knows it
+	bool isPlayable_           = false;
+	std::uint8_t Reserved_     = 0;
+
+	// the probe still holds if the file didn't change since then
+	[[nodiscard]] bool isCurrent(const MediaInfo & Other) const noexcept {
+		return Size_ == Other.Size_ and Modified_ == Other.Modified_;
+	}
+};
+static_assert(sizeof(MediaInfo) == 48);
+static_assert(std::is_trivially_copyable_v<MediaInfo>,
+              "Please keep me trivially copyable"); // guarantee relocatability!
+
+// a media file together with its name as libav wants to see it, and what is known about
+// it. the name is derived from the path once and then kept with the catalog entry of the
+// file.
+
+struct MediaFile {
+	fs::path Path_;
+	std::string Name_; // utf-8
+	MediaInfo Info_;
+};
+
+auto tryOpenAsGIF(const MediaFile & Media, const tReading & Reading) -> libav::File {
 	libav::File File;
-	if (not Filename.empty() and
-	    successful(File.emplace(Filename.c_str(), nullptr, nullptr))) {
+	if (not Media.Name_.empty() and
+	    successful(File.emplace(Media.Name_.c_str(), Media.Path_, Reading.BlockSize,
+	                            Reading.Prefetch))) {
 		File = acceptOnlyGIF(std::move(File));
 	}
 	return File;
 }
 
-auto tryOpenVideoDecoder(libav::File File) -> std::tuple<libav::File, libav::Codec> {
+// the properties of the video stream are probed, unless the file is 'Known' to be
+// playable already. the decoder starts out with the known properties then, they fill
+// in whatever the demuxer leaves out without probing.
+
+auto tryOpenVideoDecoder(libav::File File, const MediaInfo & Known)
+    -> std::tuple<libav::File, libav::Codec> {
 	if (not have(File))
 		return {};
 
 	const AVCodec * pCodec;
-	avformat_find_stream_info(File, nullptr);
+	if (not Known.isPlayable_)
+		avformat_find_stream_info(File, nullptr);
 	av_find_best_stream(File, AVMEDIA_TYPE_VIDEO, FirstStream, -1, &pCodec, 0);
-	if (File->duration <= 0)
+	if ((Known.isPlayable_ ? Known.Duration_ : File->duration) <= 0)
 		return {}; // refuse still images
 
+	auto & Stream     = *File->streams[FirstStream];
+	auto & Parameters = *Stream.codecpar;
+	if (Known.isPlayable_ and (Parameters.width <= 0 or Parameters.height <= 0)) {
+		Parameters.width  = Known.Width_;
+		Parameters.height = Known.Height_;
+	}
+	if (Known.isPlayable_ and Parameters.format < 0)
+		Parameters.format = Known.Format_;
+	if (Known.isPlayable_ and Stream.nb_frames <= 0)
+		Stream.nb_frames = Known.Frames_;
 	libav::Codec Decoder(pCodec);
 	if (have(Decoder)) {
-		avcodec_parameters_to_context(Decoder, File->streams[FirstStream]->codecpar);
+		avcodec_parameters_to_context(Decoder, &Parameters);
 		if (successful(avcodec_open2(Decoder, pCodec, nullptr)))
 			return { std::move(File), std::move(Decoder) };
 	}
 	return {};
 }
 
-using std::chrono::microseconds;
+// a media file that is opened, probed if need be, and primed with its first decoded
+// video frame such that streaming can begin right away.
 
-static constexpr bool isSameTimeUnit =
-    std::is_same_v<microseconds::period, std::ratio<1, AV_TIME_BASE>>;
-static_assert(isSameTimeUnit, "libav uses different time units");
+struct PreparedMedia {
+	fs::path Path;
+	libav::File File;
+	libav::Codec Decoder;
+	libav::Frame FirstFrame;
+	microseconds TickDuration{ 0 };
+	bool isPrimed = false;
+};
 
-auto getTickDuration(const libav::File & File) {
-	return microseconds{ av_rescale_q(1, File->streams[FirstStream]->time_base,
-		                              { 1, AV_TIME_BASE }) };
+auto decodeFirstFrame(PreparedMedia & Media) -> bool {
+	libav::Packet Packet;
+	while (successful(av_read_frame(Media.File, Packet))) {
+		const auto PacketReferenceGuard = Packet.dropReference();
+		if (Packet->stream_index != FirstStream)
+			continue;
+		if (not successful(avcodec_send_packet(Media.Decoder, Packet)))
+			break;
+		if (successful(avcodec_receive_frame(Media.Decoder, Media.FirstFrame)))
+			return true;
+	}
+	return false;
+}
+
+auto prepareMedia(MediaFile Source, const tReading & Reading) -> PreparedMedia {
+	auto [File, Decoder] =
+	    tryOpenVideoDecoder(tryOpenAsGIF(Source, Reading), Source.Info_);
+	PreparedMedia Media{ .Path    = std::move(Source.Path_),
+		                 .File    = std::move(File),
+		                 .Decoder = std::move(Decoder) };
+	if (not have(Media.Decoder))
+		return Media;
+	const auto & Known = Source.Info_;
+	Media.TickDuration = Known.isPlayable_ ? microseconds{ Known.TickDuration_ }
+	                                       : getTickDuration(Media.File);
+	Media.isPrimed     = decodeFirstFrame(Media);
+	return Media;
+}
+
+// "borrowing" is safe due to 'consteval' 😊
+consteval auto hasExtension(std::string_view Extension) {
+	return [=](const fs::path & p) {
+		return p.empty() or p.extension() == Extension;
+	};
+}
+
+static constexpr auto MaxProbeThreads = 8u;
+static constexpr auto IndexName       = ".media.index";
+static constexpr auto IndexMagic      = std::uint32_t{ 0x5844'494D }; // 'MIDX'
+static constexpr auto IndexVersion    = std::uint16_t{ 3 };
+
+auto probeMedia(const MediaFile & Media, MediaInfo Info) -> MediaInfo {
+	const auto [File, Decoder] = tryOpenVideoDecoder(tryOpenAsGIF(Media, {}), {});
+	Info.isPlayable_ = have(Decoder);
+	if (not Info.isPlayable_)
+		return Info;
+
+	const auto & Stream = *File->streams[FirstStream];
+	Info.Duration_      = File->duration;
+	Info.TickDuration_  = getTickDuration(File).count();
+	Info.Width_         = Stream.codecpar->width;
+	Info.Height_        = Stream.codecpar->height;
+	Info.Frames_        = static_cast<std::int32_t>(Stream.nb_frames);
+	Info.Format_        = static_cast<std::int16_t>(Decoder->pix_fmt);
+	return Info;
+}
+
+// the media index is a binary file in the media directory. it consists of
+//  - a header
+//  - an array of entries, one per media file
+//  - the utf-8 encoded names of the media files that the entries refer to
+// it is memory-mapped when a catalog is created such that streaming can begin right
+// away with the files that were playable before. the entries are validated lazily.
+
+struct IndexHeader {
+	std::uint32_t Magic_     = IndexMagic;
+	std::uint16_t Version_   = IndexVersion;
+	std::uint16_t EntrySize_ = 0;
+	std::uint32_t Entries_   = 0;
+	std::uint32_t NamesSize_ = 0;
+};
+struct IndexEntry {
+	MediaInfo Info_;
+	std::uint32_t NameOffset_;
+	std::uint32_t NameSize_;
+};
+static_assert(sizeof(IndexHeader) == 16 and sizeof(IndexEntry) == 56);
+
+// the names in the index are taken as plain file names within the media directory.
+// anything that might lead out of it is refused.
+
+bool isPlainName(const fs::path & Name) {
+	return not Name.empty() and not Name.has_root_path() and Name == Name.filename() and
+	       Name != "." and Name != "..";
+}
+
+auto loadIndex(const fs::path & Directory) -> std::map<fs::path, MediaInfo> {
+	const auto Mapped = caboodle::mapFile(Directory / IndexName);
+	const auto Bytes  = Mapped.bytes();
+	IndexHeader Header;
+	if (Bytes.size() < sizeof(Header))
+		return {};
+	std::memcpy(&Header, Bytes.data(), sizeof(Header));
+	const auto EntriesSize = std::size_t{ Header.Entries_ } * sizeof(IndexEntry);
+	if (Header.Magic_ != IndexMagic or Header.Version_ != IndexVersion or
+	    Header.EntrySize_ != sizeof(IndexEntry) or
+	    Bytes.size() != sizeof(Header) + EntriesSize + Header.NamesSize_)
+		return {};
+
+	const auto Entries = Bytes.subspan(sizeof(Header), EntriesSize);
+	const auto Names   = Bytes.subspan(sizeof(Header) + EntriesSize);
+	std::map<fs::path, MediaInfo> Index;
+	for (std::size_t Offset = 0; Offset < Entries.size(); Offset += sizeof(IndexEntry)) {
+		IndexEntry Entry;
+		std::memcpy(&Entry, Entries.data() + Offset, sizeof(Entry));
+		if (std::size_t{ Entry.NameOffset_ } + Entry.NameSize_ > Names.size())
+			continue;
+		const auto Name = Names.subspan(Entry.NameOffset_, Entry.NameSize_);
+		const std::u8string_view Utf8{ reinterpret_cast<const char8_t *>(Name.data()),
+			                           Name.size() };
+		if (const fs::path File{ Utf8 }; isPlainName(File))
+			Index.emplace_hint(Index.end(), Directory / File, Entry.Info_);
+	}
+	return Index;
+}
+
+// the index is replaced as a whole, readers see either the previous or the next one.
+// directories that can't be written to simply have no index.
+
+void saveIndex(const fs::path & Directory, const std::map<fs::path, MediaInfo> & Index) {
+	std::vector<IndexEntry> Entries;
+	std::string Names;
+	Entries.reserve(Index.size());
+	for (const auto & [Path, Info] : Index) {
+		const auto Name = Path.filename().u8string();
+		Entries.push_back({ .Info_       = Info,
+		                    .NameOffset_ = static_cast<std::uint32_t>(Names.size()),
+		                    .NameSize_   = static_cast<std::uint32_t>(Name.size()) });
+		Names.append(reinterpret_cast<const char *>(Name.data()), Name.size());
+	}
+	const IndexHeader Header{ .EntrySize_ = sizeof(IndexEntry),
+		                      .Entries_   = static_cast<std::uint32_t>(Entries.size()),
+		                      .NamesSize_ = static_cast<std::uint32_t>(Names.size()) };
+
+	const auto Target = Directory / IndexName;
+	auto Temporary    = Target;
+	Temporary += ".new";
+	std::ofstream File(Temporary, std::ios::binary | std::ios::trunc);
+	File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char *>(Entries.data()),
+	           static_cast<std::streamsize>(Entries.size() * sizeof(IndexEntry)));
+	File.write(Names.data(), static_cast<std::streamsize>(Names.size()));
+	File.close();
+
+	std::error_code Error;
+	if (File)
+		fs::rename(Temporary, Target, Error);
+	else
+		fs::remove(Temporary, Error);
+}
+
+// the catalog of the playable media files in a directory.
+// the files are probed in parallel on a pool of threads, each of which keeps at most
+// one file open at a time. playable files are published as soon as they are validated
+// such that streaming can begin while the scan is still going on.
+// verdicts are remembered, files are probed again only if their size or modification
+// time changes. each pass over the directory picks up new files and drops vanished
+// ones. the verdicts persist in the media index across restarts of the server.
+// the utf-8 names of the files are kept with their verdicts, too.
+// the playable files are listed in the order of their publication. files are only ever
+// appended to a listing, such that indices into it stay valid. a pass that drops files
+// replaces the listing as a whole, the previous one stays intact for its holders.
+
+struct Catalog {
+	using tListing = std::shared_ptr<std::vector<MediaFile>>;
+
+	explicit Catalog(fs::path Directory)
+	: Directory_{ std::move(Directory) } {
+		for (auto && [Path, Info] : loadIndex(Directory_)) {
+			auto Name = caboodle::utf8Path(Path);
+			if (Info.isPlayable_)
+				publish({ Path, Name, Info });
+			Verdicts_.emplace(Path, Verdict{ Info, Pass_, std::move(Name) });
+		}
+		rescan();
+	}
+
+	// start another pass over the directory unless one is going on already.
+	// the threads of the previous pass are done probing, but the last one may still be
+	// saving the index. the first thread of the new pass waits for them, the caller
+	// never does.
+	void rescan() {
+		std::scoped_lock Lock{ Mutex_ };
+		if (Busy_ > 0)
+			return;
+		auto Previous = std::exchange(Workers_, {});
+
+		using fs::directory_options::skip_permission_denied;
+		std::error_code Error;
+		Entries_ = fs::directory_iterator{ Directory_, skip_permission_denied, Error };
+		++Pass_;
+		isComplete_ = false;
+
+		Busy_ = std::clamp(std::thread::hardware_concurrency(), 1u, MaxProbeThreads);
+		Workers_.emplace_back(
+		    [this, Previous = std::move(Previous)](std::stop_token Stop) mutable {
+			    Previous.clear();
+			    probe(Stop);
+		    });
+		for (auto Thread = Busy_; Thread > 1; --Thread)
+			Workers_.emplace_back([this](std::stop_token Stop) { probe(Stop); });
+	}
+
+	[[nodiscard]] bool isComplete() const {
+		std::scoped_lock Lock{ Mutex_ };
+		return isComplete_;
+	}
+
+	// the file at 'Index' of the given 'Listing', nothing if it is not that long (yet)
+	[[nodiscard]] auto at(const tListing & Listing, std::size_t Index) const
+	    -> std::optional<MediaFile> {
+		std::scoped_lock Lock{ Mutex_ };
+		if (Index < Listing->size())
+			return (*Listing)[Index];
+		return std::nullopt;
+	}
+
+	[[nodiscard]] auto listing() const -> tListing {
+		std::scoped_lock Lock{ Mutex_ };
+		return Listing_;
+	}
+
+	// the current listing, and the index of the given file within it if it is listed
+	[[nodiscard]] auto locate(const fs::path & Path) const
+	    -> std::pair<tListing, std::optional<std::size_t>> {
+		std::scoped_lock Lock{ Mutex_ };
+		const auto Found = Listed_.find(Path);
+		if (Found == Listed_.end())
+			return { Listing_, std::nullopt };
+		return { Listing_, Found->second };
+	}
+
+	[[nodiscard]] bool isCurrent(const tListing & Listing) const {
+		std::scoped_lock Lock{ Mutex_ };
+		return Listing == Listing_;
+	}
+
+private:
+	struct Verdict {
+		MediaInfo Info_;
+		unsigned Pass_; // the latest pass that has seen the file
+		std::string Name_;
+	};
+
+	void probe(std::stop_token Stop) {
+		while (not Stop.stop_requested()) {
+			const auto Entry = nextFile();
+			if (not Entry)
+				break;
+			if (auto Media = playable(*Entry))
+				publish(std::move(*Media));
+		}
+		finishPass(Stop.stop_requested());
+	}
+
+	auto nextFile() -> std::optional<fs::directory_entry> {
+		static constexpr auto isGIF = hasExtension(".gif");
+		std::scoped_lock Lock{ Mutex_ };
+		std::error_code Error;
+		while (not Error and Entries_ != fs::directory_iterator{}) {
+			auto Entry = *Entries_;
+			Entries_.increment(Error);
+			if (isGIF(Entry.path()))
+				return Entry;
+		}
+		return std::nullopt;
+	}
+
+	// the given file if it is playable
+	auto playable(const fs::directory_entry & Entry) -> std::optional<MediaFile> {
+		std::error_code SizeError, TimeError;
+		const MediaInfo Current{
+			.Size_     = Entry.file_size(SizeError),
+			.Modified_ = Entry.last_write_time(TimeError).time_since_epoch().count()
+		};
+		if (SizeError or TimeError)
+			return std::nullopt;
+
+		MediaFile Media{ .Path_ = Entry.path() };
+		{
+			std::scoped_lock Lock{ Mutex_ };
+			const auto Known = Verdicts_.find(Media.Path_);
+			if (Known != Verdicts_.end()) {
+				auto & [Info, Pass, Name] = Known->second;
+				Media.Name_               = Name;
+				if (Info.isCurrent(Current)) {
+					Pass        = Pass_;
+					Media.Info_ = Info;
+					if (not Info.isPlayable_)
+						return std::nullopt;
+					return Media;
+				}
+			}
+		}
+		if (Media.Name_.empty())
+			Media.Name_ = caboodle::utf8Path(Media.Path_);
+		Media.Info_ = probeMedia(Media, Current);
+		std::scoped_lock Lock{ Mutex_ };
+		Verdicts_.insert_or_assign(Media.Path_,
+		                           Verdict{ Media.Info_, Pass_, Media.Name_ });
+		isChanged_ = true;
+		if (not Media.Info_.isPlayable_)
+			return std::nullopt;
+		return Media;
+	}
+
+	// files that are listed already take on the latest verdict
+	void publish(MediaFile Media) {
+		std::scoped_lock Lock{ Mutex_ };
+		const auto [Listed, isNew] = Listed_.try_emplace(Media.Path_, Listing_->size());
+		if (isNew)
+			Listing_->push_back(std::move(Media));
+		else
+			(*Listing_)[Listed->second].Info_ = Media.Info_;
+	}
+
+	// the last thread to finish a complete pass drops the files that were not seen or
+	// are no longer playable from a new listing, and updates the media index if anything
+	// has changed.
+	void finishPass(bool isInterrupted) {
+		std::unique_lock Lock{ Mutex_ };
+		if (--Busy_ > 0 or isInterrupted)
+			return;
+
+		const auto isStale = [this](const auto & Known) {
+			return Known.second.Pass_ != Pass_;
+		};
+		if (std::erase_if(Verdicts_, isStale) > 0)
+			isChanged_ = true;
+		const auto isListed = [this](const MediaFile & Media) {
+			const auto Known = Verdicts_.find(Media.Path_);
+			return Known != Verdicts_.end() and Known->second.Info_.isPlayable_;
+		};
+		if (not rgs::all_of(*Listing_, isListed)) {
+			auto Kept = std::make_shared<std::vector<MediaFile>>();
+			rgs::copy_if(*Listing_, std::back_inserter(*Kept), isListed);
+			Listing_ = std::move(Kept);
+			Listed_.clear();
+			for (std::size_t Index = 0; Index < Listing_->size(); ++Index)
+				Listed_.emplace((*Listing_)[Index].Path_, Index);
+		}
+		isComplete_ = true;
+		if (not std::exchange(isChanged_, false))
+			return;
+
+		std::map<fs::path, MediaInfo> Index;
+		for (const auto & [Path, Known] : Verdicts_)
+			Index.emplace_hint(Index.end(), Path, Known.Info_);
+		Lock.unlock();
+		std::scoped_lock Saving{ SaveMutex_ };
+		saveIndex(Directory_, Index);
+	}
+
+	fs::path Directory_;
+	mutable std::mutex Mutex_;
+	std::mutex SaveMutex_;
+	fs::directory_iterator Entries_;
+	tListing Listing_ = std::make_shared<std::vector<MediaFile>>();
+	std::map<fs::path, std::size_t> Listed_; // the index within the listing
+	std::map<fs::path, Verdict> Verdicts_;
+	unsigned Pass_   = 0;
+	unsigned Busy_   = 0;
+	bool isComplete_ = false;
+	bool isChanged_  = false;
+	std::vector<std::jthread> Workers_; // stopped and joined first on destruction
+};
+
+// all streams from the same directory share its catalog. catalogs are kept until the
+// end of the program such that their verdicts are never lost.
+
+auto catalogOf(const fs::path & Directory) -> std::shared_ptr<Catalog> {
+	static std::mutex Mutex;
+	static std::map<fs::path, std::shared_ptr<Catalog>> Catalogs;
+
+	std::scoped_lock Lock{ Mutex };
+	auto & Known = Catalogs[Directory];
+	if (not Known)
+		Known = std::make_shared<Catalog>(Directory);
+	return Known;
+}
+
+// generate an endless stream of the playable media files in the given 'Media' catalog,
+// starting over with another pass when all of them were visited.
+// the returned files are empty while the catalog has no more files to offer (yet).
+// the stream begins at 'StartAt' if the catalog knows that file already.
+// the stream walks a listing of its own. when it comes to the end of a listing that was
+// replaced meanwhile, it carries on after its latest file in the current listing.
+
+auto CatalogPathSource(std::shared_ptr<Catalog> Media, fs::path StartAt = {})
+    -> std::generator<MediaFile> {
+	auto [Listing, Found] = Media->locate(StartAt);
+	auto Index            = Found.value_or(0);
+	fs::path Latest;
+	while (true) {
+		auto File = Media->at(Listing, Index);
+		if (not File and not Media->isCurrent(Listing)) {
+			std::tie(Listing, Found) = Media->locate(Latest);
+			Index                    = Found ? *Found + 1 : 0;
+			File                     = Media->at(Listing, Index);
+		}
+		if (not File and Media->isComplete()) {
+			Media->rescan(); // pick up the latest directory contents along the way
+			Listing = Media->listing();
+			Index   = 0;
+			File    = Media->at(Listing, Index);
+		}
+		if (File) {
+			++Index;
+			Latest = File->Path_;
+		}
+		co_yield File.value_or(MediaFile{});
+	}
+}
+
+static_assert(rgs::range<decltype(CatalogPathSource({}))>);
+static_assert(rgs::viewable_range<decltype(CatalogPathSource({}))>);
+
+// transform the elements of a given range of 'Inputs' on a thread of its own, running up
+// to 'Depth' results ahead of the consumer. the results are handed over in order.
+// the thread takes at most one input at a time. it is stopped when the consumer is gone,
+// after the input at hand.
+
+template <typename R, typename F>
+class Lookahead {
+public:
+	using tResult = std::invoke_result_t<F &, rgs::range_value_t<R>>;
+
+	Lookahead(R Inputs, std::size_t Depth, F Transform)
+	: Depth_{ Depth }
+	, Worker_{ [this, Inputs = std::move(Inputs),
+	            Transform = std::move(Transform)](std::stop_token Stop) mutable {
+		run(Stop, Inputs, Transform);
+	} } {}
+
+	// the next result, nothing after the last one
+	auto next() -> std::optional<tResult> {
+		std::unique_lock Lock{ Mutex_ };
+		Changed_.wait(Lock, [this] { return not Results_.empty() or isDone_; });
+		if (Results_.empty())
+			return std::nullopt;
+		auto Result = std::move(Results_.front());
+		Results_.pop_front();
+		Changed_.notify_all();
+		return Result;
+	}
+
+private:
+	void run(std::stop_token Stop, R & Inputs, F & Transform) {
+		for (auto && Input : Inputs) {
+			{
+				std::unique_lock Lock{ Mutex_ };
+				const auto hasRoom = [this] { return Results_.size() < Depth_; };
+				if (not Changed_.wait(Lock, Stop, hasRoom))
+					return;
+			}
+			auto Result = std::invoke(Transform, std::forward<decltype(Input)>(Input));
+			std::scoped_lock Lock{ Mutex_ };
+			Results_.push_back(std::move(Result));
+			Changed_.notify_all();
+		}
+		std::scoped_lock Lock{ Mutex_ };
+		isDone_ = true;
+		Changed_.notify_all();
+	}
+
+	const std::size_t Depth_;
+	std::mutex Mutex_;
+	std::condition_variable_any Changed_;
+	std::deque<tResult> Results_;
+	bool isDone_ = false;
+	std::jthread Worker_; // stopped and joined first on destruction
+};
+
+// transform the elements of a given range of 'Inputs' ahead of the consumer, see above.
+// a 'Depth' of zero degenerates to a lazy, synchronous transformation.
+
+template <rgs::input_range R, typename F>
+auto prefetch(R Inputs, std::size_t Depth, F Transform)
+    -> std::generator<std::invoke_result_t<F &, rgs::range_value_t<R>>> {
+	if (Depth == 0) {
+		for (auto && Input : Inputs)
+			co_yield std::invoke(Transform, std::forward<decltype(Input)>(Input));
+		co_return;
+	}
+	Lookahead Ahead{ std::move(Inputs), Depth, std::move(Transform) };
+	while (auto Result = Ahead.next())
+		co_yield std::move(*Result);
 }
 
 constexpr auto makeVideoFrame(const libav::Frame & Frame, int FrameNumber,
-                              microseconds TickDuration) {
+                              microseconds TickDuration, std::uint32_t Media) {
 	FrameHeader Header = { .Width_     = Frame->width,
 		                   .Height_    = Frame->height,
 		                   .LinePitch_ = Frame->linesize[MainSubstream],
 		                   .Format_    = std::to_underlying(fromLibav(Frame->format)),
 		                   .Sequence_  = FrameNumber,
-		                   .Timestamp_ = TickDuration * Frame->pts };
+		                   .Timestamp_ = TickDuration * Frame->pts,
+		                   .Media_     = Media };
 
 	tPixels Pixels = { std::bit_cast<const std::byte *>(Frame->data[MainSubstream]),
 		               Header.SizePixels() };
-	return video::Frame{ Header, Pixels };
+	return video::Frame{ Header, Pixels, PixelsOwner{ Frame->buf[MainSubstream] } };
 }
 
 #define DECODER_HAS(x)                                                                    \
@@ -143,11 +778,21 @@ auto FrameNumber(const T & Decoder) {
 		return Decoder->frame_number;
 }
 
-auto decodeFrames(libav::File File, libav::Codec Decoder)
+// frames up to and including 'SkipUntil' are decoded but not yielded.
+
+auto decodeFrames(PreparedMedia Media, int SkipUntil = 0)
     -> std::generator<video::Frame> {
-	const auto TickDuration = getTickDuration(File);
+	auto & [Path, File, Decoder, Frame, TickDuration, isPrimed] = Media;
+	const auto isWanted = [&] { return FrameNumber(Decoder) > SkipUntil; };
+	const auto Tag      = mediaTag(Path);
 	libav::Packet Packet;
-	libav::Frame Frame;
+
+	if (isPrimed) {
+		do
+			if (isWanted())
+				co_yield makeVideoFrame(Frame, FrameNumber(Decoder), TickDuration, Tag);
+		while (successful(avcodec_receive_frame(Decoder, Frame)));
+	}
 
 	int Result = 0;
 	while (not atEndOfFile(Result) and successful(av_read_frame(File, Packet))) {
@@ -157,33 +802,34 @@ auto decodeFrames(libav::File File, libav::Codec Decoder)
 		Result = avcodec_send_packet(Decoder, Packet);
 		while (successful(Result)) {
 			Result = avcodec_receive_frame(Decoder, Frame);
-			if (successful(Result))
-				co_yield makeVideoFrame(Frame, FrameNumber(Decoder), TickDuration);
+			if (successful(Result) and isWanted())
+				co_yield makeVideoFrame(Frame, FrameNumber(Decoder), TickDuration, Tag);
 		}
 	}
 }
 
-// "borrowing" is safe due to 'consteval' 😊
-consteval auto hasExtension(std::string_view Extension) {
-	return [=](const fs::path & p) {
-		return p.empty() or p.extension() == Extension;
-	};
-}
-
 using namespace std::chrono_literals;
 
 // clang-format off
-auto makeFrames(fs::path Directory) -> std::generator<video::Frame> {
-	auto PreprocessedMediaFiles = InfinitePathSource(std::move(Directory))
-		                        | vws::filter(hasExtension(".gif"))
-		                        | vws::transform(tryOpenAsGIF)
-		                        | vws::transform(tryOpenVideoDecoder)
-		                        ;
-	for (auto [File, Decoder] : PreprocessedMediaFiles) {
-		if (have(Decoder)) {
-			std::println("decoding <{}>", File->url);
-			co_yield rgs::elements_of(
-			    decodeFrames(std::move(File), std::move(Decoder)));
+auto makeFrames(fs::path Directory, std::shared_ptr<Playhead> Position,
+                tReading Reading) -> std::generator<video::Frame> {
+	auto ResumeAt   = *Position;
+	auto MediaFiles = CatalogPathSource(catalogOf(Directory), ResumeAt.Media_);
+	const auto prepare = [Reading](MediaFile Source) {
+		return prepareMedia(std::move(Source), Reading);
+	};
+	for (auto Media : prefetch(std::move(MediaFiles), Reading.Lookahead, prepare)) {
+		if (have(Media.Decoder)) {
+			std::println("decoding <{}>", Media.File->url);
+			const auto SkipUntil = Media.Path == ResumeAt.Media_
+			                     ? std::exchange(ResumeAt.Sequence_, 0) : 0;
+			auto Path = Media.Path;
+			for (auto && Frame : decodeFrames(std::move(Media), SkipUntil)) {
+				co_yield std::move(Frame);
+				// the consumer is done with the frame when it asks for the next one
+				if (not Path.empty())
+					Position->Media_ = std::exchange(Path, {});
+			}
 		} else {
 			co_yield video::makeFillerFrame(100ms);
 		}
@@ -4,5 +4,26 @@ import std;
 import :frame;
 
 namespace video {
-export std::generator<video::Frame> makeFrames(std::filesystem::path);
+// the number of media files that are opened and primed ahead of the one currently playing
+export constexpr inline std::size_t DefaultLookahead = 2;
+
+// the position within the endless stream of frames. it is updated while frames are
+// generated, and it tells where to resume a stream that was interrupted before.
+export struct Playhead {
+	std::filesystem::path Media_; // the media file that is playing
+	int Sequence_ = 0;            // resume after this frame within 'Media_'
+};
+
+// how media files are read: libav takes 'BlockSize' bytes at a time, and 'Prefetch'
+// bytes are fetched from storage in the background ahead of it. 'Lookahead' media
+// files are opened and primed ahead of the one that is playing.
+export struct tReading {
+	std::size_t BlockSize = 64 * 1024;
+	std::size_t Prefetch  = 1024 * 1024;
+	std::size_t Lookahead = DefaultLookahead;
+};
+
+export std::generator<video::Frame> makeFrames(std::filesystem::path,
+                                               std::shared_ptr<Playhead> Position,
+                                               tReading Reading = {});
 }
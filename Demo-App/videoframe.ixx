@@ -1,8 +1,15 @@
+module;
+#include "c_resource.hpp"
+
 export module video:frame;
 import std;
 
 import libav;
 
+namespace libav {
+using tBuffer = stdex::c_resource<AVBufferRef, av_buffer_ref, av_buffer_unref>;
+}
+
 export namespace video {
 enum class PixelFormat : unsigned char { invalid, RGBA, BGRA, _largest = BGRA };
 
@@ -21,17 +28,28 @@ constexpr PixelFormat fromLibav(int Format) {
 
 namespace chrono = std::chrono;
 
+enum class FrameFlags : std::uint16_t {
+	none   = 0,
+	scaled = 1 << 0, // scaled down from the original size
+};
+
+// the frame header (version 2) with all of its fields at full width.
+// this is the representation within the application and on the wire for all clients
+// that negotiated version 2 of the protocol.
+
 struct FrameHeader {
-	static constexpr auto SizeBytes = 12u;
+	static constexpr auto SizeBytes = 28u;
 
 	using µSeconds = chrono::duration<unsigned, std::micro>;
 
-	int Width_     : 16;
-	int Height_    : 16;
-	int LinePitch_ : 16;
-	int Format_ : FormatBits();
-	int Sequence_ : 16 - FormatBits();
+	std::int32_t Width_;
+	std::int32_t Height_;
+	std::int32_t LinePitch_;
+	std::uint16_t Format_;
+	std::uint16_t Flags_;
+	std::int32_t Sequence_;
 	µSeconds Timestamp_;
+	std::uint32_t Media_; // the tag of the media file, zero if none
 
 	[[nodiscard]] constexpr size_t SizePixels() const noexcept {
 		return static_cast<size_t>(Height_) * LinePitch_;
@@ -44,6 +62,9 @@ struct FrameHeader {
 		return Sequence_ == 0 and Timestamp_.count() <= 0;
 	}
 	constexpr bool isFirstFrame() const noexcept { return Sequence_ <= 1; }
+	constexpr bool has(FrameFlags Flag) const noexcept {
+		return (Flags_ & std::to_underlying(Flag)) != 0;
+	}
 };
 static_assert(sizeof(FrameHeader) == FrameHeader::SizeBytes);
 static_assert(std::is_trivial_v<FrameHeader>,
@@ -51,15 +72,129 @@ static_assert(std::is_trivial_v<FrameHeader>,
 static_assert(std::is_trivially_destructible_v<FrameHeader>,
               "Please keep me 'implicit lifetime'");
 
+// media files are known on the wire by a tag that is derived from their path. the tags
+// are stable for the lifetime of the server process, and never zero.
+inline std::uint32_t mediaTag(const std::filesystem::path & Path) noexcept {
+	const std::uint64_t Hash = std::filesystem::hash_value(Path);
+	return static_cast<std::uint32_t>(Hash ^ (Hash >> 32)) | 1u;
+}
+
+// the compact frame header (version 1) on the wire to clients that don't negotiate.
+// the sequence number wraps around after a couple of thousand frames, and there are no
+// flags.
+
+struct FrameHeaderV1 {
+	static constexpr auto SizeBytes = 12u;
+
+	using µSeconds = FrameHeader::µSeconds;
+
+	int Width_     : 16;
+	int Height_    : 16;
+	int LinePitch_ : 16;
+	unsigned Format_ : FormatBits(); // unsigned, all formats are positive
+	int Sequence_ : 16 - FormatBits();
+	µSeconds Timestamp_;
+};
+static_assert(sizeof(FrameHeaderV1) == FrameHeaderV1::SizeBytes);
+static_assert(std::is_trivial_v<FrameHeaderV1>,
+              "Please keep me trivial"); // guarantee relocatability!
+
+constexpr FrameHeaderV1 compacted(const FrameHeader & Header) noexcept {
+	constexpr int SequenceMask = (1 << (16 - FormatBits() - 1)) - 1;
+	// keep sequence numbers of ongoing media positive, they must not look like fillers
+	const int Sequence = Header.Sequence_ <= SequenceMask
+	                         ? Header.Sequence_
+	                         : 2 + (Header.Sequence_ - 2) % (SequenceMask - 1);
+	return { .Width_     = Header.Width_,
+		     .Height_    = Header.Height_,
+		     .LinePitch_ = Header.LinePitch_,
+		     .Format_    = static_cast<unsigned>(Header.Format_),
+		     .Sequence_  = Sequence,
+		     .Timestamp_ = Header.Timestamp_ };
+}
+
+constexpr FrameHeader widened(const FrameHeaderV1 & Header) noexcept {
+	return { .Width_     = Header.Width_,
+		     .Height_    = Header.Height_,
+		     .LinePitch_ = Header.LinePitch_,
+		     .Format_    = static_cast<std::uint16_t>(Header.Format_),
+		     .Flags_     = std::to_underlying(FrameFlags::none),
+		     .Sequence_  = Header.Sequence_,
+		     .Timestamp_ = Header.Timestamp_ };
+}
+
 using tPixels = std::span<const std::byte>;
 
+// shared ownership of the reference-counted memory that holds the pixels of a frame.
+// copies are cheap and keep the pixels alive until the last holder lets go of them.
+struct PixelsOwner : libav::tBuffer {
+	using tBuffer::tBuffer;
+
+	constexpr PixelsOwner() noexcept = default;
+	constexpr PixelsOwner(PixelsOwner &&) noexcept = default;
+	constexpr PixelsOwner & operator=(PixelsOwner &&) noexcept = default;
+	constexpr PixelsOwner(const PixelsOwner & Other) noexcept
+	: tBuffer{ have(Other) ? tBuffer(Other.get()) : tBuffer{} } {}
+	constexpr PixelsOwner & operator=(const PixelsOwner & Other) noexcept {
+		if (this != &Other)
+			*this = PixelsOwner{ Other };
+		return *this;
+	}
+};
+
+// a fast, non-cryptographic 64 bit hash of the pixels, modelled after xxHash64.
+// identical pixels have identical hashes, and a hash of zero means 'unknown'.
+
+inline std::uint64_t contentHash(tPixels Pixels) noexcept {
+	constexpr std::uint64_t Prime1 = 0x9E37'79B1'85EB'CA87;
+	constexpr std::uint64_t Prime2 = 0xC2B2'AE3D'27D4'EB4F;
+	constexpr std::uint64_t Prime3 = 0x1656'67B1'9E37'79F9;
+
+	const auto load = [](tPixels Bytes) {
+		std::uint64_t Word;
+		std::memcpy(&Word, Bytes.data(), sizeof(Word));
+		return Word;
+	};
+	const auto mix = [](std::uint64_t Accumulator, std::uint64_t Word) {
+		return std::rotl(Accumulator + Word * Prime2, 31) * Prime1;
+	};
+
+	// four independent lanes keep the multipliers busy
+	std::uint64_t Lanes[4] = { Prime1 + Prime2, Prime2, 0, 0 - Prime1 };
+	auto Rest              = Pixels;
+	for (; Rest.size() >= sizeof(Lanes); Rest = Rest.subspan(sizeof(Lanes))) {
+		for (int Lane = 0; Lane < 4; ++Lane)
+			Lanes[Lane] = mix(Lanes[Lane], load(Rest.subspan(Lane * sizeof(Lanes[0]))));
+	}
+	auto Hash = std::rotl(Lanes[0], 1) + std::rotl(Lanes[1], 7) +
+	            std::rotl(Lanes[2], 12) + std::rotl(Lanes[3], 18) + Pixels.size();
+	for (; Rest.size() >= sizeof(Hash); Rest = Rest.subspan(sizeof(Hash)))
+		Hash = std::rotl(Hash ^ mix(0, load(Rest)), 27) * Prime1 + Prime3;
+	for (const auto Byte : Rest)
+		Hash = std::rotl(Hash ^ std::to_integer<unsigned>(Byte) * Prime3, 11) * Prime1;
+
+	Hash = (Hash ^ (Hash >> 33)) * Prime2;
+	Hash = (Hash ^ (Hash >> 29)) * Prime3;
+	Hash = Hash ^ (Hash >> 32);
+	return Hash != 0 ? Hash : Prime1;
+}
+
+// a frame either shares the ownership of its pixels, or it borrows them from
+// somewhere else. in the latter case the pixels are valid only as long as the lender
+// says so, e.g. until the next iteration step of a frame generator.
+// the hash of the pixels is computed only where something keys on it, until then
+// it is zero.
+
 struct Frame {
 	FrameHeader Header_;
 	tPixels Pixels_;
+	PixelsOwner Owner_;
+	std::uint64_t Hash_ = 0;
 
 	[[nodiscard]] constexpr std::size_t TotalSize() const noexcept {
 		return FrameHeader::SizeBytes + Pixels_.size_bytes();
 	}
+	[[nodiscard]] constexpr bool isShared() const noexcept { return have(Owner_); }
 };
 
 constexpr inline video::Frame noFrame{ 0 };
@@ -69,4 +204,21 @@ constexpr video::Frame makeFillerFrame(chrono::milliseconds Duration) {
 	Filler.Header_.Timestamp_ = chrono::duration_cast<FrameHeader::µSeconds>(Duration);
 	return Filler;
 }
+
+// return a frame that shares the ownership of its pixels. borrowed pixels are copied
+// into reference-counted memory.
+
+video::Frame makeShared(video::Frame Source) {
+	if (Source.isShared() or Source.Pixels_.empty())
+		return Source;
+
+	PixelsOwner Owner;
+	Owner.reset(av_buffer_alloc(Source.Pixels_.size_bytes()));
+	if (not have(Owner))
+		return noFrame;
+
+	const auto Pixels = std::as_writable_bytes(std::span{ Owner->data, Owner->size });
+	std::ranges::copy(Source.Pixels_, Pixels.begin());
+	return { Source.Header_, Pixels, std::move(Owner), Source.Hash_ };
+}
 } // namespace video
@@ -0,0 +1,130 @@
+export module video:scaler;
+import std;
+
+import :frame;
+import libav;
+
+namespace rgs = std::ranges;
+
+namespace video {
+static constexpr auto BytesPerPixel = 4;
+
+// shrink the 'Source' pixels into the 'Target' pixels by averaging all source pixels
+// that are covered by a target pixel (a.k.a. box filter).
+// the inner loops run branch-free over contiguous bytes of all channels at once such that
+// compilers can vectorize them.
+
+void boxFilter(tPixels Source, const FrameHeader & From, std::span<std::byte> Target,
+               const FrameHeader & To) {
+	const auto RowBytes = static_cast<std::size_t>(From.Width_) * BytesPerPixel;
+	std::vector<std::uint32_t> Column(RowBytes);
+
+	for (int y = 0; y < To.Height_; ++y) {
+		const int Top    = y * From.Height_ / To.Height_;
+		const int Bottom = std::max(Top + 1, (y + 1) * From.Height_ / To.Height_);
+
+		rgs::fill(Column, 0u);
+		for (int Row = Top; Row < Bottom; ++Row) {
+			const auto * Line = Source.data() + Row * From.LinePitch_;
+			for (std::size_t Byte = 0; Byte < RowBytes; ++Byte)
+				Column[Byte] += std::to_integer<std::uint32_t>(Line[Byte]);
+		}
+
+		auto * Line = Target.data() + y * To.LinePitch_;
+		for (int x = 0; x < To.Width_; ++x) {
+			const int Left  = x * From.Width_ / To.Width_;
+			const int Right = std::max(Left + 1, (x + 1) * From.Width_ / To.Width_);
+			const auto Area = static_cast<std::uint32_t>((Right - Left) * (Bottom - Top));
+
+			std::uint32_t Sum[BytesPerPixel] = {};
+			for (int Pixel = Left; Pixel < Right; ++Pixel)
+				for (int Channel = 0; Channel < BytesPerPixel; ++Channel)
+					Sum[Channel] += Column[Pixel * BytesPerPixel + Channel];
+			for (int Channel = 0; Channel < BytesPerPixel; ++Channel)
+				Line[x * BytesPerPixel + Channel] =
+				    static_cast<std::byte>((Sum[Channel] + Area / 2) / Area);
+		}
+	}
+}
+
+// swap the red and blue channels of all 'Source' pixels into the 'Target' pixels.
+
+void swapRedBlue(tPixels Source, std::span<std::byte> Target,
+                 const FrameHeader & Header) {
+	const auto RowBytes = static_cast<std::size_t>(Header.Width_) * BytesPerPixel;
+	for (int Row = 0; Row < Header.Height_; ++Row) {
+		const auto * From = Source.data() + Row * Header.LinePitch_;
+		auto * To         = Target.data() + Row * Header.LinePitch_;
+		for (std::size_t Byte = 0; Byte < RowBytes; Byte += BytesPerPixel) {
+			To[Byte + 0] = From[Byte + 2];
+			To[Byte + 1] = From[Byte + 1];
+			To[Byte + 2] = From[Byte + 0];
+			To[Byte + 3] = From[Byte + 3];
+		}
+	}
+}
+
+// create a frame with the given 'Header' and pixels that are filled in by 'Fill'.
+// the returned frame shares the ownership of its pixels.
+
+video::Frame makeFrame(const FrameHeader & Header, auto Fill) {
+	PixelsOwner Owner;
+	Owner.reset(av_buffer_alloc(Header.SizePixels()));
+	if (not have(Owner))
+		return noFrame;
+
+	const auto Pixels = std::as_writable_bytes(std::span{ Owner->data, Owner->size });
+	Fill(Pixels);
+	return { Header, Pixels, std::move(Owner), contentHash(Pixels) };
+}
+
+export {
+	// the largest size with the aspect ratio of the given frame that fits into the
+	// given bounds. frames are never scaled up, bounds of zero mean 'unbounded'.
+	// the bounds may come from a peer, the products of sizes are taken at 64 bits.
+
+	constexpr auto fittingSize(const FrameHeader & Header, int MaxWidth,
+	                           int MaxHeight) noexcept -> std::pair<int, int> {
+		const int Width  = Header.Width_;
+		const int Height = Header.Height_;
+		if (MaxWidth <= 0 or MaxHeight <= 0 or Width <= 0 or Height <= 0 or
+		    (Width <= MaxWidth and Height <= MaxHeight))
+			return { Width, Height };
+		const auto scaled = [](std::int64_t Size, std::int64_t By, std::int64_t Per) {
+			return static_cast<int>(std::max<std::int64_t>(1, Size * By / Per));
+		};
+		if (std::int64_t{ Width } * MaxHeight > std::int64_t{ Height } * MaxWidth)
+			return { MaxWidth, scaled(Height, MaxWidth, Width) };
+		return { scaled(Width, MaxHeight, Height), MaxHeight };
+	}
+
+	// return a frame with a copy of the pixels of the given 'Frame', scaled down to the
+	// given size.
+
+	video::Frame scaledTo(const video::Frame & Frame, int Width, int Height) {
+		auto Header       = Frame.Header_;
+		Header.Width_     = Width;
+		Header.Height_    = Height;
+		Header.LinePitch_ = Width * BytesPerPixel;
+		Header.Flags_ |= std::to_underlying(FrameFlags::scaled);
+
+		return makeFrame(Header, [&](std::span<std::byte> Pixels) {
+			boxFilter(Frame.Pixels_, Frame.Header_, Pixels, Header);
+		});
+	}
+
+	// return a frame with a copy of the pixels of the given 'Frame', converted between
+	// the RGBA and BGRA pixel formats.
+
+	video::Frame convertedTo(const video::Frame & Frame, PixelFormat Format) {
+		if (Frame.Header_.Format_ == std::to_underlying(Format) or Frame.Pixels_.empty())
+			return Frame;
+
+		auto Header    = Frame.Header_;
+		Header.Format_ = std::to_underlying(Format);
+		return makeFrame(Header, [&](std::span<std::byte> Pixels) {
+			swapRedBlue(Frame.Pixels_, Pixels, Header);
+		});
+	}
+} // export
+} // namespace video